@@ -54,7 +54,8 @@ public:
   /* set Data_readers */
   // for files
   void set_data_reader(int rank, int stream_nr,
-                       const std::vector<std::string> &sources);
+                       const std::vector<std::string> &sources,
+                       const Data_reader_parameters &params);
   // for tcp
   void set_TCP(int writer_rank, int writer_stream_nr,
                int reader_rank, int reader_stream_nr);
@@ -27,6 +27,8 @@ public:
   ~bit_statistics();
   void reset_statistics(int bits_per_sample_, uint64_t sample_rate_, uint64_t base_sample_rate_);
   void inc_counter(unsigned char word, bool);
+  // Add the number of samples at each of the (1 << bits_per_sample) levels
+  void add_level_counts(const int64_t *counts, bool on);
   void inc_invalid(int n);
   int64_t *get_statistics();
   int64_t *get_tsys();
@@ -35,18 +37,32 @@ public:
   uint64_t base_sample_rate;
 private:
   int64_t nInvalid;
-  std::vector<int64_t> data_counts_on;
-  std::vector<int64_t> data_counts_off;
+  // The number of samples at each level, with the tsys diode on and off
+  std::vector<int64_t> level_counts_on;
+  std::vector<int64_t> level_counts_off;
   std::vector<int64_t> statistics;
   std::vector<int64_t> tsys;
 };
 
 inline void 
 bit_statistics::inc_counter(unsigned char word, bool on){
-  if (on)
-    data_counts_on[(unsigned int)word]++;
-  else
-    data_counts_off[(unsigned int)word]++;
+  std::vector<int64_t> &counts = (on ? level_counts_on : level_counts_off);
+  if (bits_per_sample == 2) {
+    counts[word & 3]++;
+    counts[(word >> 2) & 3]++;
+    counts[(word >> 4) & 3]++;
+    counts[(word >> 6) & 3]++;
+  } else {
+    for (int j = 0; j < 8; j++)
+      counts[(word >> j) & 1]++;
+  }
+}
+
+inline void
+bit_statistics::add_level_counts(const int64_t *counts, bool on){
+  std::vector<int64_t> &level_counts = (on ? level_counts_on : level_counts_off);
+  for (int i = 0; i < (1 << bits_per_sample); i++)
+    level_counts[i] += counts[i];
 }
 
 inline void 
@@ -0,0 +1,41 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A channel extractor which gathers the bits of a subband with the
+ *     BMI2 pext instruction or lookup tables.
+ */
+#ifndef CHANNEL_EXTRACTOR_PEXT_H__
+#define CHANNEL_EXTRACTOR_PEXT_H__
+
+#include "channel_extractor_interface.h"
+
+/*******************************************************************************
+*
+* @class Channel_extractor_pext
+* @desc Extracts the subbands of Mark5A/Mark5B style data with one pext per
+* eight input bytes and subband, without the need to generate and compile a
+* channel extractor for every track layout. Produces the same output as
+* Channel_extractor_5. When the cpu has no fast pext the bits are gathered
+* with lookup tables instead, for any number of subbands. Layouts that are
+* not supported are left to Channel_extractor_dynamic.
+*******************************************************************************/
+class Channel_extractor_pext : public Channel_extractor_interface {
+public:
+  Channel_extractor_pext();
+  ~Channel_extractor_pext();
+
+  void initialise(const std::vector< std::vector<int> > &track_positions,
+                  int size_of_one_input_word,
+                  int input_sample_size, int bits_per_sample);
+
+  void extract(unsigned char *in_data1,
+               unsigned char **output_data);
+private:
+  Channel_extractor_interface* hidden_implementation_;
+};
+
+#endif // CHANNEL_EXTRACTOR_PEXT_H__
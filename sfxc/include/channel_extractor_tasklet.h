@@ -11,6 +11,7 @@
 #define CHANNEL_EXTRACTOR_TASKLET_H_
 
 #include <vector>
+#include <map>
 
 #include "utils.h"
 #include "tasklet/tasklet.h"
@@ -103,9 +104,14 @@ public:
 private:
   static void *process(void *);
 
+  /// Push the output of one input block to the output queues
+  void push_output(Output_buffer_element *output_elements);
+
   pthread_mutex_t seqno_lock;
-  pthread_cond_t seqno_cond;
+  /// Sequence number of the next input block to push to the output queues
   int seqno;
+  /// Output of the input blocks that were extracted before their predecessors
+  std::map<int, std::vector<Output_buffer_element> > reorder_buffer;
 
 protected:
   /// Queue containing input data
@@ -16,7 +16,8 @@ typedef std::pair<std::string, std::string> stream_key;
 class Input_node_parameters {
 public:
   Input_node_parameters()
-      : track_bit_rate(0), data_modulation(0) {}
+      : track_bit_rate(0), data_modulation(0), channel_extractor_threads(1),
+        data_index(true) {}
 
   class Channel_parameters {
   public:
@@ -61,10 +62,31 @@ public:
   Time overlap_time;
   // Abort the correlation if the input stream contains no valid data
   bool exit_on_empty_datastream;
+  // Number of threads extracting the channels from the input data
+  int32_t channel_extractor_threads;
+  // Keep a time-to-offset index next to the input files
+  bool data_index;
 };
 
 std::ostream &operator<<(std::ostream &out, const Input_node_parameters &param);
 
+/** Options of the data reader, which is created before the track parameters
+    are known. **/
+class Data_reader_parameters {
+public:
+  enum File_io {FILE_IO_MMAP, FILE_IO_DIRECT, FILE_IO_READ, FILE_IO_STRIPED};
+
+  Data_reader_parameters()
+      : file_io(FILE_IO_MMAP), file_readahead(64), stripe_threads(4) {}
+
+  /// How input files are read (a File_io)
+  int32_t file_io;
+  /// Amount of data read ahead in input files in MB, 0 disables read-ahead
+  int32_t file_readahead;
+  /// Number of threads that read striped input files in parallel
+  int32_t stripe_threads;
+};
+
 
 class Pulsar_parameters {
 public:
@@ -120,7 +142,7 @@ public:
     fft_size_dedispersion(0), integration_nr(-1), slice_nr(-1), sample_rate(0),
     channel_freq(0), bandwidth(0), sideband('n'), frequency_nr(-1),
     polarisation('n'), multi_phase_center(false), pulsar_binning(false),
-    window(SFXC_WINDOW_RECT) {}
+    window(SFXC_WINDOW_RECT), correlation_threads(1), bit2float_threads(1) {}
 
   bool operator==(const Correlation_parameters& other) const;
 
@@ -176,6 +198,9 @@ public:
 
   Station_list station_streams; // input streams used
   int window;                   // Windowing function to be used
+  int32_t correlation_threads;  // Number of threads used by the correlation core
+  int32_t bit2float_threads;    // Number of threads converting the input streams
+  std::string fftw_wisdom_dir;  // Directory with tuned fftw wisdom, or empty
   char source[11];              // name of the source under observation
   int32_t n_phase_centers;   // The number of phase centers in the current scan
   int32_t multi_phase_center;
@@ -229,6 +254,11 @@ public:
   int fft_size_delaycor() const;
   int fft_size_correlation() const;
   int window_function() const;
+  int correlation_threads() const;
+  int bit2float_threads() const;
+  std::string fftw_wisdom_dir() const;
+  int channel_extractor_threads() const;
+  bool data_index() const;
   int job_nr() const;
   int subjob_nr() const;
 
@@ -338,6 +368,9 @@ public:
   /* Extract structs for the correlation:             */
   /****************************************************/
 
+  // Return the options of the data reader of an input node
+  Data_reader_parameters get_data_reader_parameters() const;
+
   // Return the track parameters needed by the input node
   Input_node_parameters
   get_input_node_parameters(const std::string &mode_name,
@@ -407,7 +440,8 @@ private:
 
   mutable std::map<std::string, int> station_map;
 
-  bool check_data_source(std::ostream &log_writer, const Json::Value &) const;
+  bool check_data_source(std::ostream &log_writer, const std::string &station,
+                         const Json::Value &) const;
 };
 
 #endif /*CONTROL_PARAMETERS_H_*/
@@ -10,6 +10,7 @@
 #include "uvw_model.h"
 #include "bit_statistics.h"
 #include "timer.h"
+#include "worker_pool.h"
 #include <fstream>
 
 class Correlation_core : public Tasklet {
@@ -63,9 +64,14 @@ public:
 protected:
   virtual void integration_initialise();
   void integration_step(std::vector<Complex_buffer> &integration_buffer, int nbuffer, int stride);
+  void integration_step(std::vector<Complex_buffer> &integration_buffer, int nbuffer, int stride,
+                        size_t begin, size_t end);
+  // Number of frequency points processed at once by integration_step
+  size_t tile_size(int nbuffer);
   void integration_normalize(std::vector<Complex_buffer> &integration_buffer);
   void integration_write(std::vector<Complex_buffer> &integration_buffer, int phase_center, int source, int bin, double binweight = 1.);
   void tsys_write();
+  void initialise_output_buffers();
   void sub_integration();
   void find_invalid();
 
@@ -83,13 +89,29 @@ protected:
   void create_weights();
   void create_mask();
 
+  // Scratch space used to produce the output spectra, one per thread.
+  // The buffers hold OUTPUT_FFT_BATCH spectra.
+  struct Output_buffers {
+    SFXC_FFT fft_f2t, fft_t2f;
+    Complex_buffer temp_buffer;
+    Real_buffer real_buffer;
+  };
+  // Computes the output spectra of the baselines in batch
+  void output_spectra(std::vector<Complex_buffer> &input,
+                      const std::vector<size_t> &batch,
+                      Output_buffers &scratch);
+
+  // Jobs executed by the worker pool (see correlation_core.cc)
+  class Step_job;
+  class Sub_integration_job;
+  class Normalize_job;
+  class Output_job;
+
 protected:
   int previous_fft;
   std::vector<Input_buffer_ptr>           input_buffers;
   std::vector< std::complex<FLOAT> * >    input_elements;
   std::vector< std::vector<Invalid> * >   invalid_elements;
-  // the complex conjugate of input_elements
-  std::vector< Complex_buffer >           input_conj_buffers; 
   std::vector<bit_statistics_ptr>         statistics;
   // Tracks the number of correlator points where one (but not both) stations on a baseline had invalid data
   std::vector< std::pair<int64_t,int64_t> > n_flagged;
@@ -107,7 +129,7 @@ protected:
 
   std::vector<Complex_buffer>                          accumulation_buffers;
   std::vector< std::vector<Complex_buffer> >           phase_centers;
-  Complex_buffer_float                                 integration_buffer_float;
+  std::vector<Complex_buffer_float>                    integration_buffers_float;
   std::vector< std::pair<size_t, size_t> >             baselines;
   int number_ffts_in_slice, number_ffts_in_sub_integration, current_fft, total_ffts;
 
@@ -115,9 +137,9 @@ protected:
 
   Timer fft_timer;
 
-  SFXC_FFT fft_f2t, fft_t2f;
-  Complex_buffer temp_buffer;
-  Real_buffer real_buffer;
+  std::vector< shared_ptr<Output_buffers> >            output_buffers;
+  // The baselines of an integration are correlated in parallel by these threads
+  Worker_pool                                          workers;
   std::vector<FLOAT> window;
   std::vector<FLOAT> weights;
   std::vector<FLOAT> mask;
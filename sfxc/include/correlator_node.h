@@ -83,6 +83,7 @@ public:
 private:
   void start_threads();
   void stop_threads();
+  void load_fft_wisdom(const std::string &wisdom_dir);
 
   /// Main loop just processes mpi messages 
   void main_loop();
@@ -104,6 +105,7 @@ private:
 
   /// State variables:
   Status status;
+  bool fft_wisdom_loaded;
 };
 
 #endif // CORRELATOR_NODE_H
@@ -11,6 +11,7 @@
 #include "utils.h"
 #include "timer.h"
 #include "thread.h"
+#include "notifier.h"
 #include "correlator_node_types.h"
 #include "control_parameters.h"
 #include "bit2float_worker.h"
@@ -34,6 +35,18 @@ public:
   *****************************************************************************/
   void stop();
 
+  /*****************************************************************************
+  * @desc Set the number of threads converting the streams, stream i is
+  * handled by thread i % n_threads. Should be called before start().
+  *****************************************************************************/
+  void set_number_of_threads(int n_threads);
+
+  /*****************************************************************************
+  * @desc The threads sleep on this notifier until new input data arrives,
+  * an output buffer is released or new parameters are set.
+  *****************************************************************************/
+  void set_notifier(Notifier *notifier);
+
   /*****************************************************************************
   * @desc Channel count
   *****************************************************************************/
@@ -87,8 +100,31 @@ public:
   void get_state(std::ostream &out);
 
 private:
+  /// Additional thread which converts the streams of one group
+  class Bit2float_thread : public Thread {
+  public:
+    Bit2float_thread(Correlator_node_bit2float_tasklet &tasklet, int thread_nr)
+      : tasklet_(tasklet), thread_nr_(thread_nr) {}
+    void do_execute() {
+      tasklet_.process_streams(thread_nr_);
+    }
+  private:
+    Correlator_node_bit2float_tasklet &tasklet_;
+    int thread_nr_;
+  };
+  typedef shared_ptr<Bit2float_thread> Bit2float_thread_ptr;
+
+  /// Convert the streams of group thread_nr until the tasklet is stopped
+  void process_streams(int thread_nr);
+
   std::vector<Bit2float_worker_sptr>    bit2float_workers_;
 
+  /// Thread 0 is this thread, the others are started in do_execute
+  int n_threads_;
+  std::vector<Bit2float_thread_ptr>     threads_;
+  ThreadPool                            threadpool_;
+  Notifier                              *notifier_;
+
   /// Amount of processing time.
   Timer timer_;
 
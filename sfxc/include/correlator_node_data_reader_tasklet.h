@@ -15,7 +15,10 @@ using std::tr1::shared_ptr;
 #include "correlator_node_types.h"
 #include "data_reader.h"
 #include "data_reader_blocking.h"
+#include "notifier.h"
 
+// The size of the input buffer of a stream (a power of two)
+#define INPUT_BUFFER_SIZE           (1 << 25)
 // The number of bytes that should be free in the input buffer before we start reading
 // note that the absolute minimum would be 3 bytes for n_invalid_bytes or n_data_bytes(int16_t) + header
 #define INPUT_BUFFER_MINIMUM_FREE   1000
@@ -42,12 +45,16 @@ public:
 
   bool active();
   int get_fd();
+  /// True if the reader holds data that poll() on get_fd() does not see
+  bool has_buffered_data();
 
   const char *name() {
     return __PRETTY_FUNCTION__;
   }
 
   void set_parameters();
+  /// The notifier is notified when new data was written to the output buffer
+  void set_notifier(Notifier *notifier);
   /// Write state for debug purposes
   void get_state(std::ostream &out);
 
@@ -56,6 +63,7 @@ private:
   Data_reader_blocking_ptr  breader_;
 
   Input_buffer              input_buffer;
+  Notifier                  *notifier;
 
   bool new_stream_available;
   int stream_nr;
@@ -23,6 +23,7 @@
 #include <tasklet/tasklet_manager.h>
 #include "timer.h"
 #include "thread.h"
+#include "notifier.h"
 
 #include "monitor.h"
 #include "eventor_poll.h"
@@ -166,8 +167,18 @@ class Reader_thread : public Thread {
 //            timer_waiting_.stop();
           } else {
             timer_reading_.resume();
+            /// Data that a reader has buffered already does not wake up
+            /// poll, read it first and don't block while it is there.
+            bool buffered = false;
+            for (unsigned int i = 0; i < bit_sample_readers_.size(); i++) {
+              if (bit_sample_readers_[i]->has_buffered_data()) {
+                buffered = true;
+                if (bit_sample_readers_[i]->has_work())
+                  bit_sample_readers_[i]->do_task();
+              }
+            }
             /// Wait something happens.
-            eventsrc_.wait_until_any_event();
+            eventsrc_.wait_until_any_event(buffered ? 0 : -1);
             timer_reading_.stop();
           }
         }
@@ -212,6 +223,36 @@ class Reader_thread : public Thread {
     }
   };
 
+  /// Runs the delay correction of one station stream. The thread sleeps on
+  /// the notifier of its stream until its input or output queue changes.
+  /// Released input buffers are signalled on input_notifier.
+  class Delay_thread : public Thread {
+  public:
+    Delay_thread(Delay_correction_ptr delay_module, Notifier &notifier,
+                 Notifier &input_notifier)
+      : delay_module_(delay_module), notifier_(notifier),
+        input_notifier_(input_notifier) {}
+
+    void do_execute();
+    void stop();
+
+    void set_delay_module(Delay_correction_ptr delay_module);
+    void set_parameters(const Correlation_parameters &parameters,
+                        Delay_table_akima &delays);
+
+    Timer &timer() {
+      return timer_;
+    }
+
+  private:
+    Delay_correction_ptr delay_module_;
+    Notifier &notifier_, &input_notifier_;
+    // Makes sure the parameters are not changed during a do_task
+    Mutex mutex_;
+    Timer timer_;
+  };
+  typedef shared_ptr<Delay_thread> Delay_thread_ptr;
+
 private:
   Reader_thread reader_thread_;
   Correlator_node_bit2float_tasklet bit2float_thread_;
@@ -235,6 +276,15 @@ private:
   bool isinitialized_;
 
   std::vector< Delay_correction_ptr >         delay_modules;
+  std::vector< Delay_thread_ptr >             delay_threads;
+  /// Wakes up the bit2float threads when new input data arrives or an
+  /// output buffer of the bit2float conversion is released
+  Notifier                                    bit2float_notifier;
+  /// Wakes up the delay thread of a stream when its input is pushed or its
+  /// output is popped
+  std::vector< shared_ptr<Notifier> >         delay_notifiers;
+  /// Wakes up the correlation when the output of a delay thread is pushed
+  Notifier                                    correlation_notifier;
   Correlation_core                            *correlation_core, *correlation_core_normal;
   Correlation_core_pulsar                     *correlation_core_pulsar;
 
@@ -243,7 +293,7 @@ private:
   std::vector<Delay_table>                    delay_tables;
   std::vector<Uvw_model>                      uvw_tables;
 
-  Timer bit_sample_reader_timer_, bits_to_float_timer_, delay_timer_, correlation_timer_;
+  Timer bit_sample_reader_timer_, bits_to_float_timer_, correlation_timer_;
 
 #ifdef RUNTIME_STATISTIC
   QOS_MonitorSpeed reader_state_;
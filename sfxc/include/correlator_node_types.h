@@ -11,9 +11,14 @@
 class Correlator_node_types {
 public:
 
+  // Ring buffer of which the memory is mapped twice in a row, for any
+  // index i < size the range data[i] ... data[i + size - 1] is therefore
+  // contiguous. The size is a power of two, positions in the buffer are
+  // obtained with (index & mask).
   struct Channel_circular_input_buffer { 
-    Channel_circular_input_buffer(size_t size_)
-      : read(0), write(0), data(size_), size(size_){}
+    // The size is rounded up to a power of two (of at least a page)
+    Channel_circular_input_buffer(size_t min_size);
+    ~Channel_circular_input_buffer();
     // NB: We can correlate 36years worth of data @16gb/s per channel before we get
     // integer overflow, therefore we can be sure that read<=write 
     inline size_t bytes_free() {
@@ -23,10 +28,14 @@ public:
       return write - read;
     }
     typedef unsigned char      value_type;
-    std::vector<value_type> data; // The channel extracted from a mark5 frame
+    value_type *data; // The channel extracted from a mark5 frame
     size_t size; // The size of the data buffer
+    uint64_t mask; // size - 1
     uint64_t read;  // The index where the next data byte will be read from
     uint64_t write; // The index where the next data byte will be written to
+  private:
+    Channel_circular_input_buffer(const Channel_circular_input_buffer &);
+    Channel_circular_input_buffer &operator=(const Channel_circular_input_buffer &);
   };
   typedef Channel_circular_input_buffer  *Channel_circular_input_buffer_ptr;
 
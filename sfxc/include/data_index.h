@@ -0,0 +1,66 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A persistent index from time to byte offset in a recording.
+ */
+
+#ifndef DATA_INDEX_H
+#define DATA_INDEX_H
+
+#include <string>
+#include <vector>
+
+#include "correlator_time.h"
+
+/**
+ * Checkpoints (time, byte offset, thread id) of the frame headers in one
+ * input file, stored next to the file as <file>.sfxc-index. The readers add
+ * a checkpoint for every second of data they read or skip through, so that
+ * goto_time can seek to a checkpoint the next time the file is opened. The
+ * index grows with the file during e-VLBI recordings.
+ *
+ * The index is discarded when the inode or the first bytes of the file
+ * change. Indexing is disabled with "data_index": false in the ctrl file.
+ **/
+class Data_index {
+public:
+  struct Checkpoint {
+    /// Time of the header without the clock offset of the station
+    Time time;
+    uint64_t offset;
+    int thread_id;
+  };
+
+  Data_index(const std::string &filename);
+  /// Saves the index if checkpoints were added
+  ~Data_index();
+
+  const std::string &filename() const {
+    return filename_;
+  }
+
+  void add(const Time &time, uint64_t offset, int thread_id);
+
+  /// Find the last checkpoint before or at time which is not before offset
+  /// min_offset. Returns false if there is none.
+  bool find(const Time &time, uint64_t min_offset, Checkpoint &checkpoint) const;
+
+  void save();
+
+private:
+  bool load();
+  /// Identifies the contents of the file
+  bool get_fingerprint(uint64_t &inode, uint64_t &nbytes, uint64_t &checksum) const;
+
+  std::string filename_, index_filename_;
+  uint64_t inode_, fingerprint_size_, fingerprint_;
+  /// Sorted by offset
+  std::vector<Checkpoint> checkpoints;
+  bool modified;
+};
+
+#endif // DATA_INDEX_H
@@ -13,6 +13,7 @@
 
 #include <types.h>
 #include <iostream>
+#include <string>
 
 /** Virtual class defining the interface for obtaining input.
  **/
@@ -69,6 +70,20 @@ public:
     return -1;
   }
 
+  /** Number of bytes that the reader has received but not yet returned.
+      poll() on get_fd() does not report these.
+  **/
+  virtual size_t bytes_buffered() {
+    return 0;
+  }
+
+  /** Name of the file that is being read and the position of the read
+      pointer in that file. Returns false if the input is not a file.
+  **/
+  virtual bool get_file_position(std::string &filename, uint64_t &offset) {
+    return false;
+  }
+
 private:
   /** Function that actually writes the data to the output device.
   **/
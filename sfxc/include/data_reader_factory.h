@@ -11,10 +11,13 @@
 
 #include <string>
 #include "data_reader.h"
+#include "control_parameters.h"
 
 class Data_reader_factory {
 public:
-  static Data_reader* get_reader(const std::vector<std::string>& sources);
+  static Data_reader* get_reader(const std::vector<std::string>& sources,
+                                 const Data_reader_parameters &params =
+                                   Data_reader_parameters());
 };
 
 #endif // DATA_READER_FACTORY_H
@@ -9,28 +9,126 @@
 #define DATA_READER_FILE_H
 
 #include <queue>
+#include <deque>
 #include <vector>
-#include <fstream>
+#include <string>
+#include <pthread.h>
 
 #include "data_reader.h"
+#include "control_parameters.h"
+#include "rttimer.h"
 
+/**
+ * Reads a list of files one after the other. The files are read through a
+ * sliding mmap window (the default) or with large O_DIRECT reads, selected
+ * with file_io in the ctrl file ("mmap", "direct" or "read").
+ *
+ * A read-ahead thread keeps file_readahead MB (default 64, 0 disables the
+ * thread) ahead of the read position in flight. It opens the next file
+ * of the list before the current one ends. With O_DIRECT it reads into a
+ * ring of buffers, otherwise it loads the data into the page cache.
+ **/
 class Data_reader_file : public Data_reader {
 public:
-  Data_reader_file(const std::vector<std::string> &sources);
-  Data_reader_file(const std::string &source);
+  Data_reader_file(const std::vector<std::string> &sources,
+                   const Data_reader_parameters &params = Data_reader_parameters());
+  Data_reader_file(const std::string &source,
+                   const Data_reader_parameters &params = Data_reader_parameters());
   ~Data_reader_file();
 
   bool eof();
   bool can_read();
+  bool get_file_position(std::string &filename, uint64_t &offset);
+
+  /// Time spent waiting for data that was not read ahead, in seconds
+  double stall_time() {
+    return stall_timer.measured_time();
+  }
+
+  enum Io_method {MMAP, DIRECT, READ};
 
 private:
-  void init(const std::vector<std::string> &sources);
+  struct Input_file {
+    std::string name;
+    int fd;
+    uint64_t size;
+    Io_method io_method;
+  };
+
+  /// Data of the current or a following file read with O_DIRECT
+  struct Direct_block {
+    uint64_t file_nr, offset;
+    size_t size;
+    char *data;
+  };
+
+  void init(const std::vector<std::string> &sources,
+            const Data_reader_parameters &params);
+  bool open_file(const std::string &filename, Input_file &file);
   bool open_next_file();
+  void close_file();
   size_t do_get_bytes(size_t nBytes, char *out);
 
+  /// Copy nbytes at offset pos of the current file to out
+  bool read_mmap(uint64_t pos, size_t nbytes, char *out);
+  bool read_direct(uint64_t pos, size_t nbytes, char *out);
+  bool read_plain(uint64_t pos, size_t nbytes, char *out);
+
+  /// Read-ahead thread
+  static void *prefetch_thread(void *self);
+  void prefetch();
+  /// Amount of data read ahead of the read position, needs prefetch_lock
+  uint64_t bytes_ahead();
+  /// Return the buffers of the O_DIRECT blocks before pos in the current
+  /// file, needs prefetch_lock
+  void release_blocks(uint64_t pos);
+
   std::queue<std::string> filenames;
-  std::ifstream file;
-  std::streampos file_end;
+  Io_method io_method;
+
+  /// The current file is files[0], the others are opened in advance
+  std::deque<Input_file> files;
+  /// Position of the current file in the list
+  uint64_t file_nr;
+
+  // Copy of files[0], the read-ahead thread can change files
+  std::string file_name;
+  int fd;
+  Io_method file_io_method;
+  uint64_t file_size, file_pos;
+  bool at_eof;
+
+  // Part of the file that is mapped in memory
+  char *window;
+  uint64_t window_offset;
+  size_t window_size;
+
+  // Aligned buffers for O_DIRECT reads
+  std::vector<char *> direct_buffers;
+  std::vector<char *> free_buffers;
+  std::deque<Direct_block> direct_blocks;
+  /// Block read by the reader itself
+  Direct_block sync_block;
+
+  // The read-ahead thread, the members below and files, filenames,
+  // file_nr and file_pos are protected by prefetch_lock when it runs
+  size_t readahead;
+  bool prefetch_running, prefetch_stop;
+  /// The thread waits until the reader has used part of the data
+  bool waiting_for_reader;
+  /// The reader waits for an O_DIRECT block
+  bool reader_waiting;
+  pthread_t prefetch_tid;
+  pthread_mutex_t prefetch_lock;
+  pthread_cond_t prefetch_cond;
+  /// Position up to which the data was read ahead
+  uint64_t prefetch_file_nr, prefetch_pos;
+  /// The thread is reading from file inflight_file_nr
+  bool inflight;
+  uint64_t inflight_file_nr;
+  int n_opening;
+
+  RTTimer stall_timer;
 };
 
 #endif // DATA_READER_FILE_H
@@ -9,6 +9,7 @@
 #define DATA_READER_MK5_H
 
 #include "data_reader.h"
+#include "socket_receive_buffer.h"
 
 class Data_reader_mk5: public Data_reader {
 public:
@@ -17,12 +18,16 @@ public:
 
   bool eof();
   bool can_read();
+  size_t bytes_buffered() {
+    return receive_buffer.bytes_buffered();
+  }
 
 private:
   size_t do_get_bytes(size_t, char *);
 
   bool at_eof;
   int fd;
+  Socket_receive_buffer receive_buffer;
 };
 
 #endif // DATA_READER_MK5_H
@@ -16,6 +16,7 @@
 
 #include "network.h"
 #include "data_reader.h"
+#include "socket_receive_buffer.h"
 #include "utils.h"
 
 class Data_reader_socket : public Data_reader {
@@ -36,12 +37,18 @@ public:
     return m_socket;
   }
 
+  size_t bytes_buffered() {
+    return receive_buffer.bytes_buffered();
+  }
+
 protected:
   size_t do_get_bytes(size_t nBytes, char *buff);
 
   int m_socket;
   bool iseof;
 private:
+  /// The many small header reads are served from this buffer
+  Socket_receive_buffer receive_buffer;
 };
 
 #endif // DATAREADER_SOCKET_HH
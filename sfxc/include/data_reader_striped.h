@@ -0,0 +1,99 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A data reader that reads the files of a recording in parallel.
+ */
+
+#ifndef DATA_READER_STRIPED_H
+#define DATA_READER_STRIPED_H
+
+#include <vector>
+#include <string>
+#include <pthread.h>
+
+#include "data_reader.h"
+#include "control_parameters.h"
+
+/**
+ * Reads a recording that is spread over many files, such as the chunks of
+ * a flexbuff recording scattered over several disks, with several threads
+ * at once. The files are cut into blocks which the threads read in
+ * parallel. The reader gets the blocks back in order from a ring of twice
+ * as many block buffers as there are threads.
+ *
+ * The sources are either a list of file:// urls, or vbs://[pattern/]scan,
+ * which stands for all chunks pattern/scan/scan.NNNNNNNN (the default
+ * pattern is /mnt/disk*) in the order of their sequence number. The number
+ * of threads is set with stripe_threads in the ctrl file (default 4). A list
+ * of file:// urls is only read this way when file_io is "striped". There is
+ * no time-to-offset index for striped recordings.
+ **/
+class Data_reader_striped : public Data_reader {
+public:
+  Data_reader_striped(const std::vector<std::string> &sources,
+                      const Data_reader_parameters &params);
+  ~Data_reader_striped();
+
+  bool eof();
+  bool can_read();
+
+private:
+  struct Input_file {
+    std::string name;
+    uint64_t size;
+    int fd;
+  };
+
+  /// A part of one file
+  struct Block {
+    size_t file;
+    uint64_t offset;
+    size_t size;
+  };
+
+  enum Slot_state {FREE, READING, READY};
+  /// Buffer for one block
+  struct Slot {
+    Slot_state state;
+    uint64_t block;
+    size_t size;
+    char *data;
+  };
+
+  size_t do_get_bytes(size_t nbytes, char *out);
+
+  void add_file(const std::string &filename);
+  void add_vbs_chunks(const std::string &url);
+
+  static void *read_thread(void *self);
+  void read_blocks();
+  /// Descriptor of the file, which is opened on first use, needs lock
+  int get_fd(size_t file);
+  /// Close the files before the read position, needs lock
+  void close_files();
+
+  std::vector<Input_file> files;
+  std::vector<Block> blocks;
+  std::vector<Slot> slots;
+  std::vector<char> buffer;
+  /// Files before this one have been closed
+  size_t first_open_file;
+
+  /// Block and position in the block of the reader
+  uint64_t read_block;
+  size_t read_pos;
+  bool at_eof;
+  /// Next block that a thread will read
+  uint64_t next_block;
+
+  bool stop;
+  std::vector<pthread_t> threads;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+};
+
+#endif // DATA_READER_STRIPED_H
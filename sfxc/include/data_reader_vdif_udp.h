@@ -0,0 +1,145 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A data reader for VDIF frames sent over UDP.
+ */
+
+#ifndef DATA_READER_VDIF_UDP_H
+#define DATA_READER_VDIF_UDP_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#include "data_reader.h"
+
+/**
+ * Receives VDIF frames, one per UDP packet, from udp://[address]:port.
+ * Options are added to the url as "?option&option...":
+ *  - psn: every frame is preceded by a 64-bit packet sequence number,
+ *    counted separately for every VDIF thread
+ *  - window=N: size of the reorder buffer of a VDIF thread in frames
+ *    (default 1024)
+ *  - sockets=N: open N sockets on every port with SO_REUSEPORT, the kernel
+ *    spreads the senders over the sockets
+ *  - cpus=A,B,...: pin the receive thread of the i-th socket to CPU A, B, ...
+ * Several ports can be given as udp://[address]:port1,port2.
+ *
+ * Every socket has its own thread that receives the packets in batches with
+ * recvmmsg. The frames of each VDIF thread are put back in order, using the
+ * packet sequence number or the time in the VDIF header, and the VDIF
+ * threads are merged into one stream ordered in time. Small gaps in a VDIF
+ * thread are filled with frames that have the invalid bit set, so that the
+ * VDIF reader flags the lost data. Late, duplicated and dropped packets are
+ * counted per socket and logged every ten seconds.
+ **/
+class Data_reader_vdif_udp : public Data_reader {
+public:
+  Data_reader_vdif_udp(const std::string &url);
+  ~Data_reader_vdif_udp();
+
+  bool eof();
+  bool can_read();
+
+  struct Counters {
+    uint64_t received, lost, late, duplicated, dropped, bad_size;
+  };
+  /// Totals over all sockets
+  Counters get_counters();
+  size_t n_sockets() const {
+    return receivers.size();
+  }
+  /// Counters of one socket, lost frames are only counted in the totals
+  Counters get_counters(size_t socket);
+
+private:
+  /// A socket and the thread that drains it
+  struct Receiver {
+    Data_reader_vdif_udp *reader;
+    std::string address, port;
+    int fd, cpu;
+    bool running;
+    pthread_t thread;
+    Counters counters;
+  };
+
+  size_t do_get_bytes(size_t nbytes, char *out);
+
+  bool open_socket(Receiver &receiver);
+
+  static void *receive_thread(void *receiver);
+  void receive(Receiver &receiver);
+  /// Take the frame length from the first frame and allocate the slots,
+  /// needs lock
+  bool set_frame_length(const char *packet, size_t size);
+  /// Put the frame in slot in the reorder buffer of its VDIF thread,
+  /// needs lock
+  void add_frame(Receiver &receiver, int slot);
+  /// Pass the oldest frames in the reorder buffers on to the reader, or all
+  /// frames if flush is true, needs lock
+  void release_frames(bool flush);
+  /// Pass on one frame and fill the gap before it, needs lock
+  void release_frame(int slot);
+  void log_counters();
+
+  /// A frame for the reader
+  struct Output_frame {
+    /// Slot that holds the frame or -1 for a frame that was lost
+    int slot;
+    /// Header of a lost frame
+    char header[32];
+  };
+
+  /// Reorder buffer and the last frame that was passed on of a VDIF thread
+  struct Thread_stream {
+    /// Frames ordered by sequence number or by time
+    std::map<uint64_t, int> reorder_buffer;
+    bool frames_released;
+    uint64_t last_key;
+    char header[32];
+    uint32_t seconds, frame_nr;
+  };
+
+  std::string url;
+  bool at_eof;
+  bool use_psn;
+  size_t psn_size;
+  size_t reorder_window;
+  std::vector<Receiver> receivers;
+
+  // Set by the receive threads once the first frame has been received
+  size_t frame_length, header_length, slot_size;
+  std::vector<char> slots;
+  std::vector<int> free_slots;
+
+  std::map<int, Thread_stream> streams;
+  /// Number of frames in the reorder buffers
+  size_t n_reorder;
+  /// Time of the last packet in ms, the reorder buffers are flushed when no
+  /// packets arrive
+  int64_t last_receive;
+  /// Frames per second as far as seen in the data
+  uint32_t frames_per_second;
+  bool second_boundary_seen;
+  uint64_t lost;
+
+  std::deque<Output_frame> output_frames;
+  // Frame that is being read and the number of bytes that was used
+  Output_frame current_frame;
+  bool have_current_frame;
+  size_t current_pos;
+
+  Counters logged_counters;
+
+  bool stop;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+};
+
+#endif // DATA_READER_VDIF_UDP_H
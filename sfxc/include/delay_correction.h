@@ -47,6 +47,10 @@ public:
 
   void set_parameters(const Correlation_parameters &parameters,
                       Delay_table_akima &delays);
+  /// Overrides the choice made in set_parameters, for testing
+  void set_single_fft(bool single_fft_) {
+    single_fft = single_fft_;
+  }
   /// Do one delay step
   void do_task();
   bool has_work();
@@ -56,10 +60,16 @@ public:
   /// Write state for debug purposes
   void get_state(std::ostream &out);
 private:
-  void fractional_bit_shift(FLOAT *input,
+  void fractional_bit_shift(std::complex<FLOAT> *frequency_buffer,
                             int integer_shift,
                             double fractional_delay);
-  void fringe_stopping(FLOAT output[]);
+  void fringe_stopping(const std::complex<FLOAT> *frequency_buffer, FLOAT output[]);
+  // Delay correction in the final spectrum, used instead of
+  // fractional_bit_shift and fringe_stopping if the fringe rate is low
+  void delay_correct_spectrum(std::complex<FLOAT> *spectrum, Time tmid);
+  bool use_single_fft();
+  double fringe_phase(Time time);
+  size_t samples_per_window();
   // access functions to the correlation parameters
   size_t fft_size();
   size_t fft_rot_size();
@@ -87,6 +97,8 @@ private:
   double LO_offset;
   double start_phase;
   double extra_delay;
+  // Apply the delay correction after the final fft only (see use_single_fft)
+  bool single_fft;
 
   int n_ffts_per_integration, current_fft, total_ffts;
   size_t tbuf_start, tbuf_end;
@@ -95,7 +107,11 @@ private:
   Memory_pool_vector_element< std::complex<FLOAT> > frequency_buffer;
   Memory_pool_vector_element<FLOAT> time_buffer;
   Memory_pool_vector_element<FLOAT> temp_buffer;
+  // The windowed input of the final ffts, one window per fft
+  Memory_pool_vector_element<FLOAT> windowed_buffer;
+  std::vector<Time> window_times;
   Memory_pool_vector_element< std::complex<FLOAT> > temp_fft_buffer;
+  int temp_fft_stride;
   int temp_fft_offset;
   int output_offset;
   Memory_pool_vector_element<FLOAT> window;
@@ -108,7 +124,6 @@ private:
 
   Time fft_length;
   SFXC_FFT        fft_t2f, fft_f2t, fft_t2f_cor;
-  Memory_pool_vector_element< std::complex<FLOAT> >  exp_array;
 };
 
 inline size_t Delay_correction::fft_size() {
@@ -16,28 +16,35 @@
 #include <types.h>
 #include <vector>
 
-// GSL includes
-#include <gsl/gsl_spline.h>
-#include <gsl/gsl_errno.h>
+#if __cplusplus >= 201103L
+#include <memory>
+using std::shared_ptr;
+#else
+#include <tr1/memory>
+using std::tr1::shared_ptr;
+#endif
+
 #include "correlator_time.h"
 #include "utils.h"
 
 class MPI_Transfer;
 
+/**
+ * Delay model for a time interval. The Akima splines through the delay table
+ * are stored as one cubic polynomial per interval between two data points,
+ * the table is shared (read only) between all copies of the model.
+ **/
 class Delay_table_akima {
 friend class Delay_table;
 public:
   Delay_table_akima();
-  Delay_table_akima(const Delay_table_akima &other);
-  ~Delay_table_akima();
-  void operator=(const Delay_table_akima &other);
 
   const std::string &get_source(int phase_center){
     return sources[phase_center];
   }
   // The number of phase centers in the current scan
   int n_phase_centers(){
-    return splineakima.size();
+    return splines ? splines->size() : 0;
   }
   // delay is in seconds
   double delay(const Time &time, int phase_center=0);
@@ -47,23 +54,28 @@ public:
   double amplitude(const Time &time, int phase_center=0);
   Time scan_begin, interval_begin, interval_end; // FIXME make private again
 private:
-  void free_reference();
-  void copy(const Delay_table_akima &other);
+  // Offsets of the coefficients of the delay, phase and amplitude
+  // polynomials within the coefficients of one interval
+  enum {DELAY = 0, PHASE = 4, AMPLITUDE = 8, N_COEFFICIENTS = 12};
+
+  // The splines of one phase center. On interval i, starting at knots[i],
+  // a polynomial is evaluated as c[0] + dx * (c[1] + dx * (c[2] + dx * c[3]))
+  // with c = &coefficients[N_COEFFICIENTS * i + offset].
+  struct Spline {
+    std::vector<double> knots;
+    std::vector<double> coefficients;
+    double inv_step; // inverse of the (constant) distance between the knots
+  };
+
+  // Returns the coefficients of the interval containing time, dx is set to
+  // the time since the start of the interval
+  const double *find_interval(const Time &time, int phase_center, double &dx) const;
 private:
   Time clock_epoch;
   double clock_offset, clock_rate;
   std::vector<std::string> sources;
 
-  // GSL splining objects
-  std::vector<gsl_interp_accel *> acc;
-  std::vector<gsl_spline *> splineakima;
-  std::vector<gsl_interp_accel *> acc_ph;
-  std::vector<gsl_spline *> splineakima_ph;
-  std::vector<gsl_interp_accel *> acc_amp;
-  std::vector<gsl_spline *> splineakima_amp;
-  // Mutexes
-  pthread_mutex_t *mutex;
-  int *ref_count;
+  shared_ptr<const std::vector<Spline> > splines;
 };
 
 class Delay_table {
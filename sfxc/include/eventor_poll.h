@@ -76,15 +76,15 @@ public:
   }
 
 
-  void wait_until_any_event() {
+  void wait_until_any_event(int timeout = -1) {
     /// waiting something happens on the descriptor we are supposed
     /// to monitor -1 == no timeout.
     timer_breading_.resume();
-    int ret = poll( &(pollif_[0]), pollif_.size(), -1);
+    int ret = poll( &(pollif_[0]), pollif_.size(), timeout);
     timer_breading_.stop();
 
-    /// it cannot be zero because the timeout is set to infinite
-    SFXC_ASSERT( ret != 0 );
+    /// it cannot be zero if the timeout is set to infinite
+    SFXC_ASSERT( (ret != 0) || (timeout >= 0) );
 
     /// If the returned value == 0.
     timer_reading_.resume();
@@ -104,7 +104,7 @@ public:
           }
         }
       }
-    } else {
+    } else if (ret < 0) {
       MTHROW("An exception occurs during poll()");
     }
     timer_reading_.stop();
@@ -0,0 +1,36 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A scanner for the Mark5 fill pattern in frames of data.
+ */
+
+#ifndef FILL_PATTERN_SCANNER_H
+#define FILL_PATTERN_SCANNER_H
+
+#include <vector>
+
+#include "input_node_types.h"
+
+/// Index of the first 32-bit word in [begin, end) of data that is (fill is
+/// true) or is not (fill is false) the fill pattern, end if there is none.
+/// Uses AVX2 or SSE2 when the cpu supports it.
+size_t scan_fill_pattern(const unsigned char *data, size_t begin, size_t end,
+                         bool fill);
+
+/// The same without SIMD instructions
+size_t scan_fill_pattern_scalar(const unsigned char *data, size_t begin,
+                                size_t end, bool fill);
+
+/// Instruction set used by scan_fill_pattern
+const char *fill_pattern_scanner_name();
+
+/// Append the runs of fill pattern in the nbytes of data, from byte begin
+/// on, to the invalid blocks
+void flag_fill_pattern(const unsigned char *data, size_t nbytes, size_t begin,
+                       std::vector<Input_node_types::Invalid_block> &invalid);
+
+#endif // FILL_PATTERN_SCANNER_H
@@ -14,6 +14,7 @@
 #include "control_parameters.h"
 #include "input_node_types.h"
 #include "correlator_time.h"
+#include "data_index.h"
 
 #if __cplusplus >= 201103L
 #include <memory>
@@ -46,23 +47,56 @@ public:
 
   virtual Time time_between_headers() = 0;
 
-  bool eof();
+  virtual bool eof();
   void find_fill_pattern(Data_frame &data);
   bool is_open(){
     return is_open_;
   }
 
   virtual void set_parameters(const Input_node_parameters &param) = 0;
+  /// Use the time-to-offset index of the input files, if they are seekable
+  void set_use_index(bool use_index) {
+    use_index_ = use_index && data_reader_->is_seekable();
+  }
 
   virtual TRANSPORT_TYPE get_transport_type() const = 0;
 
 protected:
+  /// Add the header at data counter header_pos to the index of the input
+  /// file if it is the first header seen in a new second
+  void update_index(const Time &time, uint64_t header_pos, int thread_id) {
+    if (use_index_ && is_open_ && (time >= next_index_time_))
+      add_index_checkpoint(time, header_pos, thread_id);
+  }
+  /// Skip to the last indexed header before time, returns false if the
+  /// index doesn't help
+  bool goto_indexed_time(Time time, Data_index::Checkpoint &checkpoint);
+  /// Write the index of the input file
+  void save_index();
+
+  /// Number of bytes read from data_reader_ that were not used yet
+  virtual size_t bytes_buffered() {
+    return 0;
+  }
+  /// Skip nbytes of input data
+  virtual size_t skip_bytes(size_t nbytes);
+
   // Data reader: input stream
   shared_ptr<Data_reader> data_reader_;
   // Set to true if there is a valid header found in the data stream
   bool is_open_;
   // Time offset that is applied to all time stamps
   Time offset;
+
+private:
+  void add_index_checkpoint(const Time &time, uint64_t header_pos, int thread_id);
+  /// Load the index of the file that is being read, returns false if the
+  /// input is not a file
+  bool get_index(uint64_t &file_offset);
+
+  bool use_index_;
+  shared_ptr<Data_index> index_;
+  Time next_index_time_;
 };
 
 #endif // INPUT_DATA_FORMAT_READER_H
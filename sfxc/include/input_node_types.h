@@ -10,6 +10,7 @@
 #ifndef INPUT_NODE_TYPES_H
 #define INPUT_NODE_TYPES_H
 
+#include <algorithm>
 #include <vector>
 
 #if __cplusplus >= 201103L
@@ -85,6 +86,19 @@ public:
     int nr_invalid;
   };
 
+  // Append an invalid block to the list, merging with the last block
+  static void add_invalid(std::vector<Invalid_block> &invalid, int begin, int nbytes) {
+    if (!invalid.empty() &&
+        (invalid.back().invalid_begin + invalid.back().nr_invalid == begin)) {
+      invalid.back().nr_invalid += nbytes;
+    } else {
+      Invalid_block block;
+      block.invalid_begin = begin;
+      block.nr_invalid = nbytes;
+      invalid.push_back(block);
+    }
+  }
+
   // Memory pool for Mark5 frames
   struct Input_data_frame {
     Input_data_frame()
@@ -93,6 +107,23 @@ public:
 
     // List of blocks to be flagged as invalid
     std::vector<Invalid_block> invalid;
+
+    // Flag nbytes from begin as invalid, merging with the previous block
+    void add_invalid(int begin, int nbytes) {
+      Input_node_types::add_invalid(invalid, begin, nbytes);
+    }
+    // True if the invalid blocks cover the whole frame, the data of such a
+    // frame is never looked at
+    bool all_invalid() const {
+      int end = 0;
+      for (size_t i = 0; i < invalid.size(); i++) {
+        if (invalid[i].invalid_begin > end)
+          return false;
+        end = std::max(end, invalid[i].invalid_begin + invalid[i].nr_invalid);
+      }
+      return end >= (int)buffer->data.size();
+    }
+
     // The channel which the data_frame belongs to (currently VDIF only), -1 is broadcast
     int channel;
     // Start time of the mark5 block
@@ -18,6 +18,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <sys/time.h>
+#include <string.h>
 #include <ctime>
 
 class RTTimer {
@@ -1,6 +1,7 @@
 #ifndef SFXC_FFT_H
 #define SFXC_FFT_H
 #include <complex>
+#include <string>
 #include "config.h"
 
 // The sfxc fft wrapper class
@@ -14,6 +15,30 @@ public:
   virtual void ifft(const std::complex<float_type> *in, std::complex<float_type> *out) = 0;
   virtual void rfft(const float_type *in, std::complex<float_type> *out) = 0;
   virtual void irfft(const std::complex<float_type> *in, float_type *out) = 0;
+
+  // Batched transforms: transform i reads from in + i * idist and writes to
+  // out + i * odist (in elements of the input and output type).
+  // The default implementation simply loops over the transforms.
+  virtual void fft_many(const std::complex<float_type> *in, int idist,
+                        std::complex<float_type> *out, int odist, int howmany) {
+    for (int i = 0; i < howmany; i++)
+      fft(in + i * idist, out + i * odist);
+  }
+  virtual void ifft_many(const std::complex<float_type> *in, int idist,
+                         std::complex<float_type> *out, int odist, int howmany) {
+    for (int i = 0; i < howmany; i++)
+      ifft(in + i * idist, out + i * odist);
+  }
+  virtual void rfft_many(const float_type *in, int idist,
+                         std::complex<float_type> *out, int odist, int howmany) {
+    for (int i = 0; i < howmany; i++)
+      rfft(in + i * idist, out + i * odist);
+  }
+  virtual void irfft_many(const std::complex<float_type> *in, int idist,
+                          float_type *out, int odist, int howmany) {
+    for (int i = 0; i < howmany; i++)
+      irfft(in + i * idist, out + i * odist);
+  }
 public:
   int size;
 };
@@ -30,6 +55,18 @@ public:
   void ifft(const std::complex<float> *in, std::complex<float> *out);
   void rfft(const float *in, std::complex<float> *out);
   void irfft(const std::complex<float> *in, float *out);
+
+  // IPP has no planner, these exist for compatibility with the fftw class
+  static std::string wisdom_filename(const std::string &dir) {
+    return std::string();
+  }
+  static bool import_wisdom(const std::string &filename) {
+    return false;
+  }
+  static bool export_wisdom(const std::string &filename) {
+    return false;
+  }
+  static void set_planner_flags(unsigned int flags) {}
 private:
   void alloc();
   void alloc_r2c();
@@ -44,6 +81,7 @@ private:
 #else // USE FFTW
 #include <fftw3.h>
 #include <string.h>
+#include <vector>
   class sfxc_fft_fftw_float : public sfxc_fft<float>{
   public:
     sfxc_fft_fftw_float();
@@ -53,10 +91,38 @@ private:
     void ifft(const std::complex<float> *in, std::complex<float> *out);
     void rfft(const float *in, std::complex<float> *out);
     void irfft(const std::complex<float> *in, float *out);
+    void fft_many(const std::complex<float> *in, int idist,
+                  std::complex<float> *out, int odist, int howmany);
+    void ifft_many(const std::complex<float> *in, int idist,
+                   std::complex<float> *out, int odist, int howmany);
+    void rfft_many(const float *in, int idist,
+                   std::complex<float> *out, int odist, int howmany);
+    void irfft_many(const std::complex<float> *in, int idist,
+                    float *out, int odist, int howmany);
+
+    // Wisdom (the fftw plans for all transforms planned so far) is stored in
+    // a file per precision
+    static std::string wisdom_filename(const std::string &dir);
+    static bool import_wisdom(const std::string &filename);
+    static bool export_wisdom(const std::string &filename);
+    // Planner rigor of new plans, FFTW_ESTIMATE by default
+    static void set_planner_flags(unsigned int flags);
   private:
     void free_buffers(); 
     fftwf_plan alloc(int sign, bool inplace);
     fftwf_plan alloc_r2c(int sign);
+    // The batched transforms need a plan for each layout
+    enum many_type {MANY_FORWARD, MANY_BACKWARD, MANY_R2C, MANY_C2R};
+    struct many_plan {
+      fftwf_plan plan;
+      many_type type;
+      int howmany, idist, odist;
+      bool inplace;
+    };
+    fftwf_plan get_many_plan(many_type type, int howmany, int idist, int odist,
+                             bool inplace);
+    fftwf_plan alloc_many(many_type type, int howmany, int idist, int odist,
+                          bool inplace);
   public:
     int size;
   private:
@@ -66,6 +132,7 @@ private:
     bool plan_forward_I_set, plan_backward_I_set;
     fftwf_plan  plan_forward_r2c, plan_backward_r2c;
     bool plan_forward_r2c_set, plan_backward_r2c_set;
+    std::vector<many_plan> many_plans;
   };
 #endif // USE_IPP
 #endif // SFXC_FFT_H
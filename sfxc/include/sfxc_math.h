@@ -1,6 +1,7 @@
 #ifndef SFXC_MATH_H
 #define SFXC_MATH_H
 #include <complex>
+#include <stdint.h>
 #include "config.h"
 
 // Define basic math functions
@@ -194,4 +195,30 @@
     }
   }
 #endif
+
+// dest[i] += s1[i] * conj(s2[i]), vectorised kernels are selected at run
+// time depending on the capabilities of the CPU (see sfxc_math.cc)
+void sfxc_add_product_conj_fc(const std::complex<float> *s1, const std::complex<float> *s2, std::complex<float> *dest, int len);
+void sfxc_add_product_conj_c(const std::complex<double> *s1, const std::complex<double> *s2, std::complex<double> *dest, int len);
+
+// Phasor rotations with phasor[i] = amplitude * exp(j * (phase + i * delta)),
+// vectorised in the same way (see sfxc_math.cc)
+// data[i] *= phasor[i]
+void sfxc_rotate_fc(std::complex<float> *data, int len, double phase, double delta, double amplitude);
+void sfxc_rotate_c(std::complex<double> *data, int len, double phase, double delta, double amplitude);
+// out[i] = real(in[i] * phasor[i])
+void sfxc_rotate_real_fc(const std::complex<float> *in, float *out, int len, double phase, double delta, double amplitude);
+void sfxc_rotate_real_c(const std::complex<double> *in, double *out, int len, double phase, double delta, double amplitude);
+// out[i] += in[i] * phasor[i]
+void sfxc_add_rotated_fc(const std::complex<float> *in, std::complex<float> *out, int len, double phase, double delta, double amplitude);
+void sfxc_add_rotated_c(const std::complex<double> *in, std::complex<double> *out, int len, double phase, double delta, double amplitude);
+
+// Unpack nbytes bytes of 2 bit (four samples per byte) or 1 bit (eight
+// samples per byte) data, first sample in the least significant bits:
+// out[i] = levels[sample i]. The number of samples at every level is added
+// to counts (see sfxc_math.cc)
+void sfxc_unpack_2bit_f(const unsigned char *in, int nbytes, const float *levels, float *out, int64_t *counts);
+void sfxc_unpack_2bit(const unsigned char *in, int nbytes, const double *levels, double *out, int64_t *counts);
+void sfxc_unpack_1bit_f(const unsigned char *in, int nbytes, const float *levels, float *out, int64_t *counts);
+void sfxc_unpack_1bit(const unsigned char *in, int nbytes, const double *levels, double *out, int64_t *counts);
 #endif // SFXC_MATH_H
@@ -0,0 +1,25 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - Detection of the x86 SIMD intrinsics used by the vectorised kernels.
+ */
+#ifndef SFXC_SIMD_H
+#define SFXC_SIMD_H
+
+// The kernels are compiled with the target attribute and selected at run
+// time with __builtin_cpu_supports, which needs GCC 4.9 or later.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define SFXC_X86_SIMD
+#include <immintrin.h>
+// _pext_u64 is only declared for 64-bit targets
+#ifdef __x86_64__
+#define SFXC_X86_PEXT
+#endif
+#endif
+
+#endif // SFXC_SIMD_H
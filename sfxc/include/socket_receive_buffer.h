@@ -0,0 +1,54 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A receive buffer for stream sockets.
+ */
+
+#ifndef SOCKET_RECEIVE_BUFFER_H
+#define SOCKET_RECEIVE_BUFFER_H
+
+#include <sys/types.h>
+
+#include "types.h"
+
+#define SOCKET_RECEIVE_BUFFER_SIZE ((size_t)1024 * 1024)
+// Reads of at least this size bypass the buffer
+#define SOCKET_DIRECT_READ_SIZE    ((size_t)16 * 1024)
+
+/**
+ * Reads from a stream socket through a large page-aligned buffer, so that
+ * the many small reads of headers cost one system call per buffer. Large
+ * reads go straight into the caller's memory with MSG_WAITALL.
+ * Bytes are skipped with recv(MSG_TRUNC) on TCP sockets, which discards the
+ * data in the kernel without copying it.
+ **/
+class Socket_receive_buffer {
+public:
+  Socket_receive_buffer();
+  ~Socket_receive_buffer();
+
+  /// Like read(2) on fd, but out == NULL skips the bytes. Returns 0 at the
+  /// end of the stream and -1 on an error.
+  ssize_t receive(int fd, size_t nbytes, char *out);
+
+  size_t bytes_buffered() const {
+    return buffer_end - buffer_pos;
+  }
+
+private:
+  Socket_receive_buffer(const Socket_receive_buffer &);
+  Socket_receive_buffer &operator=(const Socket_receive_buffer &);
+
+  ssize_t skip(int fd, size_t nbytes);
+
+  char *buffer;
+  size_t buffer_pos, buffer_end;
+  /// -1 if not yet known for this socket
+  int can_truncate;
+};
+
+#endif // SOCKET_RECEIVE_BUFFER_H
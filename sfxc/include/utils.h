@@ -49,6 +49,14 @@
 // The (maximum) amount of samples processed per iteration, this is automatically set to a multiple of nchannels
 #define CORRELATOR_BUFFER_SIZE    8192
 
+// The amount of data (inputs and accumulators) the correlation core tries to
+// keep in cache while it walks the spectrum in frequency tiles
+#define CORRELATOR_TILE_BYTES     (256*1024)
+
+// The number of baseline spectra that are transformed together when the
+// correlator output is written
+#define OUTPUT_FFT_BATCH          8
+
 #define SIZE_VLBA_FRAME           20000
 #define SIZE_VLBA_HEADER          96
 #define SIZE_VLBA_AUX_HEADER      64
@@ -162,6 +170,12 @@ void pause_sfxc_for_gdb(void);
     #define SFXC_ADD_F              sfxc_add
     #define SFXC_ADD_FC             sfxc_add_c
     #define SFXC_ADD_PRODUCT_FC     sfxc_add_product_c 
+    #define SFXC_ADD_PRODUCT_CONJ_FC sfxc_add_product_conj_c
+    #define SFXC_ROTATE_FC          sfxc_rotate_c
+    #define SFXC_ROTATE_REAL_FC     sfxc_rotate_real_c
+    #define SFXC_ADD_ROTATED_FC     sfxc_add_rotated_c
+    #define SFXC_UNPACK_2BIT        sfxc_unpack_2bit
+    #define SFXC_UNPACK_1BIT        sfxc_unpack_1bit
     #define SFXC_MUL_F              sfxc_mul
     #define SFXC_MUL_FC             sfxc_mul_fc
   #else // !USE_DOUBLE
@@ -175,6 +189,12 @@ void pause_sfxc_for_gdb(void);
     #define SFXC_ADD_F              sfxc_add_f
     #define SFXC_ADD_FC             sfxc_add_fc
     #define SFXC_ADD_PRODUCT_FC     sfxc_add_product_fc 
+    #define SFXC_ADD_PRODUCT_CONJ_FC sfxc_add_product_conj_fc
+    #define SFXC_ROTATE_FC          sfxc_rotate_fc
+    #define SFXC_ROTATE_REAL_FC     sfxc_rotate_real_fc
+    #define SFXC_ADD_ROTATED_FC     sfxc_add_rotated_fc
+    #define SFXC_UNPACK_2BIT        sfxc_unpack_2bit_f
+    #define SFXC_UNPACK_1BIT        sfxc_unpack_1bit_f
     #define SFXC_MUL_F              sfxc_mul_f
     #define SFXC_MUL_FC             sfxc_mul_fc
   #endif
@@ -193,6 +213,12 @@ void pause_sfxc_for_gdb(void);
     #define SFXC_ADD_F              sfxc_add
     #define SFXC_ADD_FC             sfxc_add_c
     #define SFXC_ADD_PRODUCT_FC     sfxc_add_product_c 
+    #define SFXC_ADD_PRODUCT_CONJ_FC sfxc_add_product_conj_c
+    #define SFXC_ROTATE_FC          sfxc_rotate_c
+    #define SFXC_ROTATE_REAL_FC     sfxc_rotate_real_c
+    #define SFXC_ADD_ROTATED_FC     sfxc_add_rotated_c
+    #define SFXC_UNPACK_2BIT        sfxc_unpack_2bit
+    #define SFXC_UNPACK_1BIT        sfxc_unpack_1bit
     #define SFXC_MUL_F              sfxc_mul
     #define SFXC_MUL_FC             sfxc_mul_c
   #else // !USE_DOUBLE
@@ -207,6 +233,12 @@ void pause_sfxc_for_gdb(void);
     #define SFXC_ADD_F              sfxc_add_f
     #define SFXC_ADD_FC             sfxc_add_fc
     #define SFXC_ADD_PRODUCT_FC     sfxc_add_product_fc 
+    #define SFXC_ADD_PRODUCT_CONJ_FC sfxc_add_product_conj_fc
+    #define SFXC_ROTATE_FC          sfxc_rotate_fc
+    #define SFXC_ROTATE_REAL_FC     sfxc_rotate_real_fc
+    #define SFXC_ADD_ROTATED_FC     sfxc_add_rotated_fc
+    #define SFXC_UNPACK_2BIT        sfxc_unpack_2bit_f
+    #define SFXC_UNPACK_1BIT        sfxc_unpack_1bit_f
     #define SFXC_MUL_F              sfxc_mul_f
     #define SFXC_MUL_FC             sfxc_mul_fc
   #endif
@@ -29,6 +29,8 @@ using std::tr1::shared_ptr;
 
 // The number VDIF frames to be read is rounded to this number of bytes
 #define VDIF_FRAME_BUFFER_SIZE    (8192 * 5)
+// Amount of data that is read from the data reader at once
+#define VDIF_READ_BUFFER_SIZE     ((size_t)256 * 1024)
 
 class VDIF_reader : public Input_data_format_reader {
   enum Debug_level {
@@ -102,7 +104,20 @@ public:
     return VDIF;
   }
 
+protected:
+  size_t bytes_buffered() {
+    return read_buffer_end - read_buffer_pos;
+  }
+  size_t skip_bytes(size_t nbytes);
+
 private:
+  /// Read a block of frames from the read buffer if all headers are valid
+  bool read_frames(Data_frame &data);
+  /// Make sure that the read buffer contains at least nbytes
+  bool fill_read_buffer(size_t nbytes);
+  /// Read nbytes through the read buffer, out == NULL skips the data
+  size_t read_bytes(size_t nbytes, char *out);
+
   // Time information
   int ref_jday; //date relative to which times are calculated(mod Julian day)
   // current time in microseconds
@@ -124,6 +139,11 @@ private:
 
   // Mapping between thread IDs and channel numbers.
   std::map<int, int> thread_map;
+
+  // Data is read from the data reader in large blocks, which saves two
+  // calls to the data reader per frame
+  std::vector<char> read_buffer;
+  size_t read_buffer_pos, read_buffer_end;
 };
 
 inline Time 
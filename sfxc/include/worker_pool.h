@@ -0,0 +1,68 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <pthread.h>
+
+/**
+ * A fixed set of threads which execute a job in parallel (fork-join). The
+ * thread calling run() takes part in the work, a pool of size n therefore
+ * starts n-1 threads. A pool of size 1 simply runs the job in the calling
+ * thread.
+ **/
+class Worker_pool {
+public:
+  /// A piece of work which can be split into independent parts
+  class Job {
+  public:
+    virtual ~Job() {}
+    /// Process part `part' out of `n_parts'
+    virtual void run(int part, int n_parts) = 0;
+  };
+
+  Worker_pool();
+  ~Worker_pool();
+
+  /// Set the number of threads (including the calling thread)
+  void resize(int n_threads);
+  int size() const {
+    return threads.size() + 1;
+  }
+
+  /// Run all parts of job and wait until every part is done
+  void run(Job &job);
+
+  /// Split the range [0, n) in n_parts contiguous ranges of (almost) equal
+  /// length, with boundaries that are a multiple of align.
+  static void partition(size_t n, int part, int n_parts,
+                        size_t &begin, size_t &end, size_t align = 1);
+
+private:
+  struct Worker {
+    Worker_pool *pool;
+    int part;
+    int generation; // last job started by this worker
+  };
+
+  static void *process(void *);
+  void stop_threads();
+
+  std::vector<pthread_t> threads;
+  std::vector<Worker>    workers;
+
+  pthread_mutex_t lock;
+  pthread_cond_t  start_cond, done_cond;
+  Job  *job;
+  int  generation;
+  int  n_busy;
+  bool stopping;
+};
+
+#endif // WORKER_POOL_H
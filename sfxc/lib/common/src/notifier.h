@@ -0,0 +1,64 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - common library
+ * This file contains:
+ *   - Notifier class declaration and definition
+ */
+#ifndef NOTIFIER_H
+#define NOTIFIER_H
+
+#include "condition.h"
+#include "raiimutex.h"
+
+/*****************************************
+* @class Notifier
+* @desc Lets threads sleep until some
+* other thread signals that something
+* changed (e.g. data was pushed on a
+* queue), instead of polling.
+* A waiter first reads count(), checks
+* for work and then calls wait(count).
+* A notification that arrives in between
+* is therefore never lost.
+******************************************/
+class Notifier {
+public:
+  Notifier() : count_(0) {}
+
+  /************************************
+  * Return the number of notifications
+  * so far, to be passed to wait().
+  *************************************/
+  unsigned int count() {
+    RAIIMutex rc(condition_);
+    return count_;
+  }
+
+  /************************************
+  * Wake up all the waiting threads.
+  *************************************/
+  void notify() {
+    RAIIMutex rc(condition_);
+    count_++;
+    condition_.broadcast();
+  }
+
+  /************************************
+  * Wait until notify() is called after
+  * count was obtained.
+  *************************************/
+  void wait(unsigned int count) {
+    RAIIMutex rc(condition_);
+    while (count_ == count)
+      condition_.wait();
+  }
+
+private:
+  Condition condition_;
+  unsigned int count_;
+};
+
+#endif // NOTIFIER_H
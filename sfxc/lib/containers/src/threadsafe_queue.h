@@ -21,6 +21,7 @@
 #include "mutex.h"
 #include "raiimutex.h"
 #include "condition.h"
+#include "notifier.h"
 #include "exception_common.h"
 #include "allocator.h"
 
@@ -48,6 +49,9 @@ class QueueClosedException : public Exception
 *      - pop is thread-safe an blocking.
 *      - pop_non_blocking is thread-safe and....
 *      - empty is thread-safe non blocking
+*      - push and pop wake up the (optional)
+*        push and pop notifiers once the
+*        queue is unlocked
 *
 ***********************************************/
 template<class T>
@@ -56,12 +60,21 @@ public:
   typedef T     Type;
   typedef Type  value_type;
 
-  Threadsafe_queue() { isclose_ = false; }
+  Threadsafe_queue() : push_notifier_(NULL), pop_notifier_(NULL) { isclose_ = false; }
   virtual ~Threadsafe_queue() { close(); }
 
+  /// push_notifier is notified each time an element is pushed, it wakes up
+  /// the consumer. pop_notifier is notified each time an element is popped,
+  /// it wakes up the producer. Either can be NULL.
+  void set_notifiers(Notifier *push_notifier, Notifier *pop_notifier) {
+    push_notifier_ = push_notifier;
+    pop_notifier_ = pop_notifier;
+  }
+
   void push( Type element ) {
 		if( isclose_ )throw QueueClosedException();
 
+    Notify_on_exit ne(push_notifier_);
     RAIIMutex rc(m_queuecond);
     m_queue.push_back(element);
     if( m_queue.size() != 0 ) m_queuecond.signal();
@@ -98,6 +111,7 @@ public:
   }
 
   void pop() {
+    Notify_on_exit ne(pop_notifier_);
     RAIIMutex rc(m_queuecond);
     while ( m_queue.size() == 0 ){
 			 if( isclose_ )throw QueueClosedException();
@@ -108,6 +122,7 @@ public:
   }
 
   Type front_and_pop() {
+    Notify_on_exit ne(pop_notifier_);
     RAIIMutex rc(m_queuecond);
     while ( m_queue.size() == 0 ){
 			 if( isclose_ )throw QueueClosedException();
@@ -120,6 +135,7 @@ public:
   }
 
   Type front_and_pop_non_blocking() {
+    Notify_on_exit ne(pop_notifier_);
     RAIIMutex rc(m_queuecond);
     if ( m_queue.size() == 0 ){
 			if( isclose_ )throw QueueClosedException();
@@ -161,8 +177,19 @@ class Test : public Test_aclass<Threadsafe_queue> {
 #endif // ENABLE_TEST_UNIT
 
 private:
+  // Notifies on destruction. It is declared before the RAIIMutex, so the
+  // notification is sent after the queue is unlocked.
+  class Notify_on_exit {
+  public:
+    Notify_on_exit(Notifier *notifier) : notifier_(notifier) {}
+    ~Notify_on_exit() { if (notifier_ != NULL) notifier_->notify(); }
+  private:
+    Notifier *notifier_;
+  };
+
   std::deque<Type> m_queue;
   Condition m_queuecond;
+  Notifier *push_notifier_, *pop_notifier_;
 
   bool isclose_;
 };
@@ -210,8 +210,9 @@ get_status(int rank) {
 void
 Abstract_manager_node::
 set_data_reader(int rank, int32_t stream_nr,
-                const std::vector<std::string> &sources) {
-  int len = sizeof(int32_t);
+                const std::vector<std::string> &sources,
+                const Data_reader_parameters &params) {
+  int len = sizeof(int32_t) + sizeof(Data_reader_parameters);
 
   for (int i = 0; i < sources.size(); i++)
     len += sources[i].size() + 1;
@@ -220,6 +221,8 @@ set_data_reader(int rank, int32_t stream_nr,
   char *p = msg;
   memcpy(p, &stream_nr, sizeof(int32_t));
   p += sizeof(int32_t);
+  memcpy(p, &params, sizeof(Data_reader_parameters));
+  p += sizeof(Data_reader_parameters);
 
   for (int i = 0; i < sources.size(); i++) {
     memcpy(p, sources[i].c_str(), sources[i].size() + 1);
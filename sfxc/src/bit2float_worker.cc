@@ -34,10 +34,10 @@ Bit2float_worker::Bit2float_worker(int stream_nr_, bit_statistics_ptr statistics
 
 int64_t
 Bit2float_worker::do_task() {
-  std::vector<unsigned char> &inp_data = input_buffer_->data;
+  const unsigned char *inp_data = input_buffer_->data;
   int64_t samples_written = 0;
 
-  size_t inp_size = inp_data.size();
+  const uint64_t inp_mask = input_buffer_->mask;
 
   Output_pool_data &out_frame = out_element.data();
   size_t output_buffer_size = out_frame.data.size();
@@ -55,17 +55,17 @@ Bit2float_worker::do_task() {
         return samples_written;
       }
 
-      uint8_t header = inp_data[read++ % inp_size];
+      uint8_t header = inp_data[read++ & inp_mask];
       switch(header) {
       case HEADER_DATA:
-        bytes_left = inp_data[read++ % inp_size];
-        bytes_left |= (inp_data[read++ % inp_size] << 8);
+        bytes_left = inp_data[read++ & inp_mask];
+        bytes_left |= (inp_data[read++ & inp_mask] << 8);
         SFXC_ASSERT(bytes_left > 0);
         state = SEND_DATA;
         break;
       case HEADER_DELAY:
       {
-        int8_t new_delay = inp_data[read++ % inp_size];
+        int8_t new_delay = inp_data[read++ & inp_mask];
         if (cur_delay < 0) {
           // the initial delay at the beginning of the integration
           sample_in_byte = new_delay;
@@ -85,8 +85,8 @@ Bit2float_worker::do_task() {
         break;
       }
       case HEADER_INVALID:{
-        invalid_left = inp_data[read++ % inp_size];
-        invalid_left |= (inp_data[read++ % inp_size] << 8);
+        invalid_left = inp_data[read++ & inp_mask];
+        invalid_left |= (inp_data[read++ & inp_mask] << 8);
         statistics->inc_invalid(invalid_left);
         int start = current_fft * fft_size;
         invalid.push_back((Invalid){start + out_index, invalid_left});
@@ -155,7 +155,7 @@ Bit2float_worker::do_task() {
       bytes_left -= bytes_to_advance;
       if (bytes_left == 0) {
         if ((write - read) > 0) {
-          switch(inp_data[read % inp_size]) {
+          switch(inp_data[read & inp_mask]) {
           case HEADER_ENDSTREAM:
             read += 1;
             state = IDLE;
@@ -171,8 +171,8 @@ Bit2float_worker::do_task() {
           case HEADER_DATA:
             if ((write - read) >= 3) {
               read += 1;
-              bytes_left = inp_data[read++ % inp_size];
-              bytes_left |= (inp_data[read++ % inp_size] << 8);
+              bytes_left = inp_data[read++ & inp_mask];
+              bytes_left |= (inp_data[read++ & inp_mask] << 8);
               SFXC_ASSERT(bytes_left > 0);
             }
             break;
@@ -298,6 +298,12 @@ set_parameters() {
     tsys_count = ((sample_rate / (2 * tsys_freq)) - tsys_count);
     // Convert to bytes.  
     tsys_count /= 4;
+    // Less than a byte left in this half-cycle, start with the next one.
+    if (tsys_count == 0) {
+      tsys_count = (sample_rate / (2 * tsys_freq)) / 4;
+      tsys_on = !tsys_on;
+    }
+    SFXC_ASSERT(tsys_count > 0);
   }
   queue_.pop();
 }
@@ -315,9 +321,9 @@ Bit2float_worker::new_sptr(int stream_nr_, bit_statistics_ptr statistics_){
 
 int 
 Bit2float_worker::bit2float(FLOAT *output, int start, int nsamples, uint64_t *readp) {
-  std::vector<unsigned char> &input_data = input_buffer_->data;
-  int dsize = input_data.size();
-  uint64_t read = *readp;
+  // The input buffer is mapped twice, so the input data is contiguous
+  const unsigned char *input_data = &input_buffer_->data[*readp & input_buffer_->mask];
+  int read = 0; // bytes read
   // avoid the overhead of the shared pointer by dereferencing it
   bit_statistics *stats = statistics.get();
 
@@ -326,9 +332,9 @@ Bit2float_worker::bit2float(FLOAT *output, int start, int nsamples, uint64_t *re
     // Write the first byte
     int samp_to_write = std::min(nsamples, 4 - start);
     memcpy((char*)&output[iout],
-           &lookup_table[(int)input_data[read % dsize]][start],
+           &lookup_table[(int)input_data[read]][start],
            samp_to_write * sizeof(FLOAT));
-    stats->inc_counter(input_data[read % dsize], tsys_on);
+    stats->inc_counter(input_data[read], tsys_on);
     if (--tsys_count == 0) {
       tsys_count = (sample_rate / (2 * tsys_freq)) / 4;
       tsys_on = !tsys_on;
@@ -340,32 +346,31 @@ Bit2float_worker::bit2float(FLOAT *output, int start, int nsamples, uint64_t *re
     else
       return start + samp_to_write;
 
-    // Write the main bulk of the data
+    // Write the main bulk of the data, up to the next tsys on/off
+    // transition at a time
     int nbytes = nsamples / 4;
     while (nbytes > 0) {
-      int index = read % dsize;
-      int towrite = std::min(nbytes, dsize-index);
-      for (int end = index+towrite; index < end; index++) {
-        memcpy((char*)&output[iout],
-               &lookup_table[(int)input_data[index]][0],
-               4 * sizeof(FLOAT));
-        stats->inc_counter(input_data[index], tsys_on);
-	if (--tsys_count == 0) {
-	  tsys_count = (sample_rate / (2 * tsys_freq)) / 4;
-	  tsys_on = !tsys_on;
-	}
-        iout += 4;
+      int chunk = std::min(nbytes, tsys_count);
+      int64_t counts[4] = {0, 0, 0, 0};
+      SFXC_UNPACK_2BIT(&input_data[read], chunk, sample_value_ms,
+                       &output[iout], counts);
+      stats->add_level_counts(counts, tsys_on);
+      tsys_count -= chunk;
+      if (tsys_count == 0) {
+        tsys_count = (sample_rate / (2 * tsys_freq)) / 4;
+        tsys_on = !tsys_on;
       }
-      nbytes -= towrite;
-      nsamples -= towrite * 4;
-      read += towrite;
+      nbytes -= chunk;
+      nsamples -= chunk * 4;
+      iout += 4 * chunk;
+      read += chunk;
     }
     // Write the final byte
     if (nsamples > 0) {
       memcpy((char*)&output[iout],
-             &lookup_table[(int)input_data[read % dsize]][0],
+             &lookup_table[(int)input_data[read]][0],
              nsamples * sizeof(FLOAT));
-      *readp = read;
+      *readp += read;
       return nsamples;
     }
   } else { // 1 bit samples
@@ -373,9 +378,9 @@ Bit2float_worker::bit2float(FLOAT *output, int start, int nsamples, uint64_t *re
     // Write the first byte
     int samp_to_write = std::min(nsamples, 8 - start);
     memcpy((char*)&output[iout],
-           &lookup_table_1bit[(int)input_data[read % dsize]][start],
+           &lookup_table_1bit[(int)input_data[read]][start],
            samp_to_write * sizeof(FLOAT));
-    stats->inc_counter(input_data[read % dsize], true);
+    stats->inc_counter(input_data[read], true);
     nsamples -= samp_to_write;
     iout += samp_to_write;
     if (samp_to_write+start == 8)
@@ -385,31 +390,26 @@ Bit2float_worker::bit2float(FLOAT *output, int start, int nsamples, uint64_t *re
 
     // Write the main bulk of the data
     int nbytes = nsamples / 8;
-    while (nbytes>0) {
-      int index = read % dsize;
-      int towrite = std::min(nbytes, dsize-index);
-      for (int end = index+towrite; index < end; index++) {
-        memcpy((char*)&output[iout],
-               &lookup_table_1bit[(int)input_data[index]][0],
-               8 * sizeof(FLOAT));
-        stats->inc_counter(input_data[index], true);
-        iout += 8;
-      }
-      nbytes -= towrite;
-      nsamples -= towrite * 8;
-      read += towrite;
+    if (nbytes > 0) {
+      int64_t counts[2] = {0, 0};
+      SFXC_UNPACK_1BIT(&input_data[read], nbytes, sample_value_m,
+                       &output[iout], counts);
+      stats->add_level_counts(counts, true);
+      iout += 8 * nbytes;
+      nsamples -= nbytes * 8;
+      read += nbytes;
     }
     // Write the final byte
     if (nsamples>0) {
       memcpy((char*)&output[iout],
-             &lookup_table_1bit[(int)input_data[read % dsize]][0],
+             &lookup_table_1bit[(int)input_data[read]][0],
              nsamples * sizeof(FLOAT));
-      *readp = read;
+      *readp += read;
       return nsamples;
     }
   }
 
-  *readp = read;
+  *readp += read;
   return 0;
 }
 
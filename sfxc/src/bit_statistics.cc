@@ -22,8 +22,8 @@ const int64_t gcd(int64_t a, int64_t b)
 }
 
 bit_statistics::bit_statistics() : bits_per_sample(-1) {
-  data_counts_on.assign(256, 0);
-  data_counts_off.assign(256, 0);
+  level_counts_on.assign(4, 0);
+  level_counts_off.assign(4, 0);
   nInvalid = 0;
 }
 
@@ -37,8 +37,8 @@ bit_statistics::reset_statistics(int bits_per_sample_, uint64_t sample_rate_,
   bits_per_sample = bits_per_sample_;
   sample_rate = sample_rate_;
   base_sample_rate = base_sample_rate_;
-  data_counts_on.assign(256, 0);
-  data_counts_off.assign(256, 0);
+  level_counts_on.assign(4, 0);
+  level_counts_off.assign(4, 0);
   nInvalid = 0;
 
   int64_t div = gcd(sample_rate, base_sample_rate);
@@ -48,30 +48,11 @@ bit_statistics::reset_statistics(int bits_per_sample_, uint64_t sample_rate_,
 
 int64_t *
 bit_statistics::get_statistics() {
-  SFXC_ASSERT((bits_per_sample >= 1) && (bits_per_sample <= 8));
+  SFXC_ASSERT((bits_per_sample == 1) || (bits_per_sample == 2));
   statistics.assign(5, 0);
 
-  if (bits_per_sample == 2) {
-    for (int i = 0; i < 256; i++) {
-      statistics[i & 3] += data_counts_on[i];
-      statistics[(i >> 2) & 3] += data_counts_on[i];
-      statistics[(i >> 4) & 3] += data_counts_on[i];
-      statistics[(i >> 6) & 3] += data_counts_on[i];
-      statistics[i & 3] += data_counts_off[i];
-      statistics[(i >> 2) & 3] += data_counts_off[i];
-      statistics[(i >> 4) & 3] += data_counts_off[i];
-      statistics[(i >> 6) & 3] += data_counts_off[i];
-    }
-  } else {
-    int bps = bits_per_sample;
-    int max_val = ((1 << bps) - 1);
-    for(int i = 0; i < 256; i++) {
-      for(int j = 0; j < (8 /bps); j++) {
-        statistics[(i >> j * bps) & max_val] += data_counts_on[i];
-        statistics[(i >> j * bps) & max_val] += data_counts_off[i];
-      }
-    }
-  }
+  for (int i = 0; i < (1 << bits_per_sample); i++)
+    statistics[i] += level_counts_on[i] + level_counts_off[i];
   statistics[statistics.size()-1] += nInvalid;
   for (size_t i = 0; i < statistics.size(); i++)
     statistics[i] = (base_sample_rate * statistics[i]) / sample_rate;
@@ -80,23 +61,10 @@ bit_statistics::get_statistics() {
 
 int64_t *
 bit_statistics::get_tsys() {
-  std::vector<int64_t> on, off;
-
-  on.assign(4, 0);
-  off.assign(4, 0);
   tsys.assign(4, 0);
 
   if (bits_per_sample == 2) {
-    for (int i = 0; i < 256; i++) {
-      on[i & 3] += data_counts_on[i];
-      on[(i >> 2) & 3] += data_counts_on[i];
-      on[(i >> 4) & 3] += data_counts_on[i];
-      on[(i >> 6) & 3] += data_counts_on[i];
-      off[i & 3] += data_counts_off[i];
-      off[(i >> 2) & 3] += data_counts_off[i];
-      off[(i >> 4) & 3] += data_counts_off[i];
-      off[(i >> 6) & 3] += data_counts_off[i];
-    }
+    const std::vector<int64_t> &on = level_counts_on, &off = level_counts_off;
     tsys[0] = on[1] + on[2];
     tsys[1] = on[0] + on[3];
     tsys[2] = off[1] + off[2];
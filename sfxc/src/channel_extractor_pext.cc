@@ -0,0 +1,323 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - Implementation of a channel extractor with the BMI2 pext instruction
+ *     or lookup tables.
+ */
+
+#include "channel_extractor_pext.h"
+#include "channel_extractor_dynamic.h"
+#include "sfxc_simd.h"
+#include "utils.h"
+
+#include <cstring>
+
+namespace {
+
+// How the bits gathered by pext (in increasing track order) are reordered
+// into the output samples
+enum Permutation { IDENTITY, SWAP_PAIRS, TABLE };
+
+struct Subband_layout {
+  // The bits of one subband in eight bytes of input
+  uint64_t mask;
+  // The same gather without pext: the masked bits of input byte i are
+  // gather[i][byte], shifted left by gather_shift[i]
+  uint8_t gather[8][256];
+  int gather_shift[8];
+  Permutation permutation;
+  uint8_t table[256];
+};
+
+inline uint64_t permute(uint64_t word, const Subband_layout &layout) {
+  switch (layout.permutation) {
+  case IDENTITY:
+    return word;
+  case SWAP_PAIRS:
+    return ((word >> 1) & 0x5555555555555555ULL) |
+           ((word & 0x5555555555555555ULL) << 1);
+  default:
+    uint64_t result = 0;
+    for (int i = 0; i < 64; i += 8)
+      result |= (uint64_t)layout.table[(word >> i) & 0xff] << i;
+    return result;
+  }
+}
+
+// Gathers the masked bits with the per byte tables, for cpus without a
+// fast pext
+struct Table_gather {
+  static inline uint64_t gather(uint64_t input, const Subband_layout &layout) {
+    uint64_t result = 0;
+    for (int i = 0; i < 8; i++)
+      result |= (uint64_t)layout.gather[i][(input >> (8 * i)) & 0xff] << layout.gather_shift[i];
+    return result;
+  }
+};
+
+#ifdef SFXC_X86_PEXT
+struct Pext_gather {
+  __attribute__((target("bmi2")))
+  static inline uint64_t gather(uint64_t input, const Subband_layout &layout) {
+    return _pext_u64(input, layout.mask);
+  }
+};
+#endif
+
+// Gathers 64 output bits per subband at a time. The input for one output
+// word is at most 512 bytes, which stays in the L1 cache while all subbands
+// are extracted from it.
+template<int word_size, int fan_out, class Gather>
+__attribute__((always_inline))
+inline void extract_bits(const unsigned char *in, int n_input_bytes,
+                         const std::vector<Subband_layout> &subbands,
+                         unsigned char **output_data) {
+  const int bits_per_load = (8 / word_size) * fan_out;
+  const int loads_per_word = 64 / bits_per_load;
+  const int bytes_per_word = 8 * loads_per_word;
+  const int n_subbands = subbands.size();
+
+  int in_pos = 0, out_pos = 0;
+  for (; in_pos + bytes_per_word <= n_input_bytes;
+       in_pos += bytes_per_word, out_pos += 8) {
+    for (int subband = 0; subband < n_subbands; subband++) {
+      uint64_t word = 0;
+      for (int i = 0; i < loads_per_word; i++) {
+        uint64_t input;
+        memcpy(&input, in + in_pos + 8 * i, 8);
+        word |= Gather::gather(input, subbands[subband]) << (i * bits_per_load);
+      }
+      word = permute(word, subbands[subband]);
+      memcpy(output_data[subband] + out_pos, &word, 8);
+    }
+  }
+
+  if (in_pos < n_input_bytes) {
+    // Last partial output word, pad the input with zeros
+    unsigned char tail[bytes_per_word];
+    memset(tail, 0, bytes_per_word);
+    memcpy(tail, in + in_pos, n_input_bytes - in_pos);
+    const int n_output_bytes =
+      ((n_input_bytes - in_pos) / word_size) * fan_out / 8;
+    for (int subband = 0; subband < n_subbands; subband++) {
+      uint64_t word = 0;
+      for (int i = 0; i < loads_per_word; i++) {
+        uint64_t input;
+        memcpy(&input, tail + 8 * i, 8);
+        word |= Gather::gather(input, subbands[subband]) << (i * bits_per_load);
+      }
+      word = permute(word, subbands[subband]);
+      memcpy(output_data[subband] + out_pos, &word, n_output_bytes);
+    }
+  }
+}
+
+template<int word_size, int fan_out>
+void extract_table(const unsigned char *in, int n_input_bytes,
+                   const std::vector<Subband_layout> &subbands,
+                   unsigned char **output_data) {
+  extract_bits<word_size, fan_out, Table_gather>(in, n_input_bytes, subbands,
+                                                 output_data);
+}
+
+#ifdef SFXC_X86_PEXT
+template<int word_size, int fan_out>
+__attribute__((target("bmi2")))
+void extract_pext(const unsigned char *in, int n_input_bytes,
+                  const std::vector<Subband_layout> &subbands,
+                  unsigned char **output_data) {
+  extract_bits<word_size, fan_out, Pext_gather>(in, n_input_bytes, subbands,
+                                                output_data);
+}
+#endif
+
+template<int word_size_, int fan_out_>
+class Channel_extractor_pext_impl : public Channel_extractor_interface {
+public:
+  Channel_extractor_pext_impl(bool use_pext_) : use_pext(use_pext_) {}
+
+  void initialise(const std::vector< std::vector<int> > &track_positions,
+                  int IGNORED_size_of_one_input_word,
+                  int input_sample_size,
+                  int bits_per_sample) {
+    SFXC_ASSERT(((int64_t)input_sample_size * fan_out_) % 8 == 0);
+    n_input_bytes = input_sample_size * word_size_;
+
+    const int samples_per_load = 8 / word_size_;
+    subbands.resize(track_positions.size());
+    for (size_t subband = 0; subband < track_positions.size(); subband++) {
+      const std::vector<int> &tracks = track_positions[subband];
+      SFXC_ASSERT(tracks.size() == fan_out_);
+      Subband_layout &layout = subbands[subband];
+
+      // The same tracks for every input word in the eight bytes
+      layout.mask = 0;
+      for (int sample = 0; sample < samples_per_load; sample++) {
+        for (int track_nr = 0; track_nr < fan_out_; track_nr++) {
+          SFXC_ASSERT(tracks[track_nr] < 8 * word_size_);
+          layout.mask |= (uint64_t)1 << (8 * word_size_ * sample + tracks[track_nr]);
+        }
+      }
+      int shift = 0;
+      for (int byte = 0; byte < 8; byte++) {
+        const int byte_mask = (layout.mask >> (8 * byte)) & 0xff;
+        layout.gather_shift[byte] = shift;
+        for (int value = 0; value < 256; value++) {
+          int bits = 0, n = 0;
+          for (int bit = 0; bit < 8; bit++) {
+            if ((byte_mask >> bit) & 1)
+              bits |= ((value >> bit) & 1) << n++;
+          }
+          layout.gather[byte][value] = bits;
+        }
+        shift += __builtin_popcount(byte_mask);
+      }
+
+      // pext returns the bits of a sample ordered by track number. In the
+      // output the bits of every sample are ordered as in Channel_extractor_5.
+      int rank[fan_out_], position[fan_out_];
+      bool identity = true, swap_pairs = (bits_per_sample == 2);
+      for (int track_nr = 0; track_nr < fan_out_; track_nr++) {
+        rank[track_nr] = 0;
+        for (int i = 0; i < fan_out_; i++) {
+          if (tracks[i] < tracks[track_nr])
+            rank[track_nr]++;
+        }
+        position[track_nr] = bits_per_sample * (track_nr / bits_per_sample) +
+                             (track_nr + 1) % bits_per_sample;
+        identity = identity && (rank[track_nr] == position[track_nr]);
+        swap_pairs = swap_pairs && (rank[track_nr] == (position[track_nr] ^ 1));
+      }
+      if (identity) {
+        layout.permutation = IDENTITY;
+      } else if (swap_pairs) {
+        layout.permutation = SWAP_PAIRS;
+      } else {
+        layout.permutation = TABLE;
+        for (int value = 0; value < 256; value++) {
+          layout.table[value] = 0;
+          for (int group = 0; group < 8; group += fan_out_) {
+            for (int track_nr = 0; track_nr < fan_out_; track_nr++) {
+              if ((value >> (group + rank[track_nr])) & 1)
+                layout.table[value] |= 1 << (group + position[track_nr]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void extract(unsigned char *in_data1,
+               unsigned char **output_data) {
+#ifdef SFXC_X86_PEXT
+    if (use_pext) {
+      extract_pext<word_size_, fan_out_>(in_data1, n_input_bytes, subbands,
+                                         output_data);
+      return;
+    }
+#endif
+    extract_table<word_size_, fan_out_>(in_data1, n_input_bytes, subbands,
+                                        output_data);
+  }
+
+private:
+  std::vector<Subband_layout> subbands;
+  int n_input_bytes;
+  bool use_pext;
+};
+
+template<int word_size>
+Channel_extractor_interface* create_pext_(int fan_out, bool use_pext) {
+  switch (fan_out) {
+  case 1:
+    return new Channel_extractor_pext_impl<word_size, 1>(use_pext);
+  case 2:
+    return new Channel_extractor_pext_impl<word_size, 2>(use_pext);
+  case 4:
+    return new Channel_extractor_pext_impl<word_size, 4>(use_pext);
+  case 8:
+    return new Channel_extractor_pext_impl<word_size, 8>(use_pext);
+  }
+  return NULL;
+}
+
+Channel_extractor_interface* create_pext_(int size_of_one_input_word,
+                                          int fan_out, bool use_pext) {
+  switch (size_of_one_input_word) {
+  case 1:
+    return create_pext_<1>(fan_out, use_pext);
+  case 2:
+    return create_pext_<2>(fan_out, use_pext);
+  case 4:
+    return create_pext_<4>(fan_out, use_pext);
+  case 8:
+    return create_pext_<8>(fan_out, use_pext);
+  }
+  return NULL;
+}
+
+bool pext_is_fast() {
+#ifdef SFXC_X86_PEXT
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("bmi2"))
+    return false;
+#if __GNUC__ >= 7
+  // pext is microcoded on Zen and Zen 2 and slower than the tables
+  if (__builtin_cpu_is("amdfam17h"))
+    return false;
+#endif
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+Channel_extractor_pext::Channel_extractor_pext() {
+  name_ = "Channel_extractor_pext";
+  hidden_implementation_ = NULL;
+}
+
+Channel_extractor_pext::~Channel_extractor_pext() {
+  delete hidden_implementation_;
+}
+
+void Channel_extractor_pext::initialise(const std::vector< std::vector<int> > &track_positions,
+                                        int size_of_one_input_word,
+                                        int input_sample_size,
+                                        int bits_per_sample) {
+  SFXC_ASSERT(track_positions.size() > 0);
+  const size_t fan_out = track_positions[0].size();
+  bool same_fan_out = true;
+  for (size_t i = 1; i < track_positions.size(); i++)
+    same_fan_out = same_fan_out && (track_positions[i].size() == fan_out);
+
+  delete hidden_implementation_;
+  hidden_implementation_ = NULL;
+  const bool use_pext = pext_is_fast();
+  if (same_fan_out)
+    hidden_implementation_ = create_pext_(size_of_one_input_word, (int)fan_out,
+                                          use_pext);
+  if (hidden_implementation_ == NULL) {
+    // Layouts that neither gather handles
+    hidden_implementation_ = new Channel_extractor_dynamic();
+    name_ = "Channel_extractor_pext(using Channel_extractor_dynamic)";
+  } else if (use_pext) {
+    name_ = "Channel_extractor_pext";
+  } else {
+    name_ = "Channel_extractor_pext(table gather)";
+  }
+  hidden_implementation_->initialise(track_positions, size_of_one_input_word,
+                                     input_sample_size, bits_per_sample);
+}
+
+void Channel_extractor_pext::extract(unsigned char *in_data1,
+                                     unsigned char **output_data) {
+  SFXC_ASSERT(hidden_implementation_ != NULL);
+  hidden_implementation_->extract(in_data1, output_data);
+}
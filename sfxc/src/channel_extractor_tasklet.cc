@@ -8,16 +8,11 @@
  */
 #include "channel_extractor_tasklet.h"
 #include "channel_extractor_5.h"
-#include "channel_extractor_dynamic.h"
+#include "channel_extractor_pext.h"
 
 #include "mark5a_header.h"
 #include "vdif_reader.h"
 
-// Number of threads for paralle processing in the channel extraction phase.
-#ifndef NUM_CHANNEL_EXTRACTOR_THREADS
-#define NUM_CHANNEL_EXTRACTOR_THREADS 0
-#endif
-
 //#define USE_EXTRACTOR_5
 
 // Increase the size of the output_memory_pool_ to allow more buffering
@@ -28,16 +23,15 @@ Channel_extractor_tasklet(Data_format_reader_ptr reader)
     n_subbands(0),
     fan_out(0), seqno(0),
     N(0), samples_per_block(0),
-    num_channel_extractor_threads(NUM_CHANNEL_EXTRACTOR_THREADS) {
+    num_channel_extractor_threads(0) {
   init_stats();
   last_duration_=0;
 #ifdef USE_EXTRACTOR_5
   ch_extractor = new Channel_extractor_5();
 #else
-  /// This one is much more better as it will select
-  /// dynamically the best channelizer that can handle the
-  /// input data-stream.
-  ch_extractor = new Channel_extractor_dynamic();
+  /// Gathers the bits of every subband with pext when the cpu
+  /// supports BMI2 and with lookup tables otherwise.
+  ch_extractor = new Channel_extractor_pext();
 #endif //USE_EXTRACTOR_5
 }
 
@@ -74,7 +68,6 @@ void Channel_extractor_tasklet::do_execute() {
 
   if (num_channel_extractor_threads > 0) {
     pthread_mutex_init(&seqno_lock, NULL);
-    pthread_cond_init(&seqno_cond, NULL);
     for (int i = 0; i < num_channel_extractor_threads; i++)
       pthread_create(&process_thread[i], NULL, process, static_cast<void*>(this));
   }
@@ -97,6 +90,8 @@ void Channel_extractor_tasklet::do_execute() {
   if (num_channel_extractor_threads > 0) {
     for (int j = 0; j < num_channel_extractor_threads; j++)
       pthread_join(process_thread[j], NULL);
+    reorder_buffer.clear();
+    pthread_mutex_destroy(&seqno_lock);
   }
  
   // Empty input buffer
@@ -198,35 +193,50 @@ Channel_extractor_tasklet::do_task() {
 
   // Channel extract
   // This is done in a separate class to allow for different optimizations
+  // Frames without valid data only pass on their invalid blocks
   //timer_processing_.resume();
-  ch_extractor->extract((unsigned char *) &input_element.buffer->data[0],
-                        output_positions);
+  if (!input_element.all_invalid())
+    ch_extractor->extract((unsigned char *) &input_element.buffer->data[0],
+                          output_positions);
 
   //timer_processing_.stop();
 
   if (num_channel_extractor_threads > 0) {
+    // The blocks have to reach the output queues in the order in which they
+    // were read. A block that is ready before its predecessors is parked in
+    // the reorder buffer, so that the thread can continue with the next
+    // block. The thread that finishes the oldest block pushes it together
+    // with the parked blocks that follow it.
     pthread_mutex_lock(&seqno_lock);
     data_processed_ += input_element.buffer->data.size();
-    while (input_element.seqno != seqno)
-      pthread_cond_wait(&seqno_cond, &seqno_lock);
+    if (input_element.seqno != seqno) {
+      SFXC_ASSERT(input_element.seqno > seqno);
+      reorder_buffer[input_element.seqno].assign(output_elements,
+                                                 output_elements + n_subbands_recorded);
+    } else {
+      push_output(output_elements);
+      seqno++;
+      std::map<int, std::vector<Output_buffer_element> >::iterator parked;
+      while (((parked = reorder_buffer.begin()) != reorder_buffer.end()) &&
+             (parked->first == seqno)) {
+        push_output(&parked->second[0]);
+        reorder_buffer.erase(parked);
+        seqno++;
+      }
+    }
     pthread_mutex_unlock(&seqno_lock);
   } else {
     data_processed_ += input_element.buffer->data.size();
+    push_output(output_elements);
   }
+}
 
-  { // release the input buffer and put the output buffer
-    for (size_t i=0; i<n_subbands; i++) {
-      size_t j = subbandmap[i];
-      SFXC_ASSERT(output_buffers_[j] != Output_buffer_ptr());
-      output_buffers_[i]->push(output_elements[j]);
-    }
-  }
-
-  if (num_channel_extractor_threads > 0) {
-    pthread_mutex_lock(&seqno_lock);
-    seqno++;
-    pthread_cond_broadcast(&seqno_cond);
-    pthread_mutex_unlock(&seqno_lock);
+void
+Channel_extractor_tasklet::push_output(Output_buffer_element *output_elements) {
+  for (size_t i=0; i<n_subbands; i++) {
+    size_t j = subbandmap[i];
+    SFXC_ASSERT(output_buffers_[j] != Output_buffer_ptr());
+    output_buffers_[i]->push(output_elements[j]);
   }
 }
 
@@ -261,6 +271,9 @@ void
 Channel_extractor_tasklet::
 set_parameters(const Input_node_parameters &param){
   n_subbands = param.channels.size();
+  // The input node sets the parameters before it starts the tasklet, the
+  // extractor threads are created in do_execute
+  num_channel_extractor_threads = param.channel_extractor_threads - 1;
   bits_per_sample = param.bits_per_sample();
   fan_out = bits_per_sample * param.subsamples_per_sample();
   N = reader_->bytes_per_input_word();
@@ -332,7 +345,8 @@ void Channel_extractor_tasklet::empty_input_queue() {
 
 void Channel_extractor_tasklet::get_state(std::ostream &out) {
   out << "\t\"Channel_extractor\": {\n"
-      << "\t\t\"nthreads\": " << NUM_CHANNEL_EXTRACTOR_THREADS << ",\n"
+      << "\t\t\"nthreads\": " << num_channel_extractor_threads + 1 << ",\n"
+      << "\t\t\"reorder_buffer_size\": " << reorder_buffer.size() << ",\n"
       << "\t\t\"nsubbands\": " << n_subbands << ",\n"
       << "\t\t\"memory_pool_size\": " << output_memory_pool_.size() << ",\n"
       << "\t\t\"memory_pool_free\": " << output_memory_pool_.number_free_element() << ",\n"
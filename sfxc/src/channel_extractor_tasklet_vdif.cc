@@ -30,7 +30,8 @@ Channel_extractor_tasklet_VDIF::do_task() {
   // The struct containing the data for processing
   Input_buffer_element &input_element = input_buffer_->front();
 
-  // dechannelized output buffer
+  // Every thread contains a single channel, the frames are passed on by
+  // sharing the reference counted memory pool element of the reader
   Output_buffer_element  output_element;
   output_element.channel_data = input_element.buffer;
   output_element.start_time = input_element.start_time;
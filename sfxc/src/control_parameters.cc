@@ -242,6 +242,7 @@ Control_parameters::reference_station_number() const {
 
 bool
 Control_parameters::check_data_source(std::ostream &writer,
+				      const std::string &station,
 				      const Json::Value& value) const
 {
   bool ok = true;
@@ -251,11 +252,27 @@ Control_parameters::check_data_source(std::ostream &writer,
     std::string filename = create_path((*source_it).asString());
 
     if (filename.find("file://")  != 0 &&
-	filename.find("mk5://") != 0) {
+	filename.find("mk5://") != 0 &&
+	filename.find("udp://") != 0 &&
+	filename.find("vbs://") != 0) {
       ok = false;
       writer << "Ctrl-file: invalid data source '" << filename << "'"
 	     << std::endl;
     }
+
+    // The input node is set up for the data format of the first scan
+    if ((filename.find("udp://") == 0) && (ctrl["start"] != Json::Value())) {
+      int scan_nr = scan(Time(ctrl["start"].asString()));
+      if (scan_nr != -1) {
+	std::string mode = get_vex().get_mode(scan(scan_nr));
+	if (data_format(station, mode) != "VDIF") {
+	  ok = false;
+	  writer << "Ctrl-file: data source '" << filename << "' of station "
+		 << station << ", udp:// is only supported for VDIF data"
+		 << std::endl;
+	}
+      }
+    }
   }
 
   return ok;
@@ -350,6 +367,57 @@ Control_parameters::check(std::ostream &writer) const {
     }
   }
 
+  { // Check the number of threads
+    if (ctrl["correlation_threads"] != Json::Value()){
+      if (ctrl["correlation_threads"].asInt() < 1){
+        ok = false;
+        writer << "Ctrl-file: correlation_threads should be at least 1" << std::endl;
+      }
+    }
+    if (ctrl["bit2float_threads"] != Json::Value()){
+      if (ctrl["bit2float_threads"].asInt() < 1){
+        ok = false;
+        writer << "Ctrl-file: bit2float_threads should be at least 1" << std::endl;
+      }
+    }
+    if (ctrl["fftw_wisdom_dir"] != Json::Value()){
+      std::string wisdom_dir = create_path(ctrl["fftw_wisdom_dir"].asString());
+      if (strncmp(wisdom_dir.c_str(), "file://", 7) != 0) {
+        ok = false;
+        writer << "Ctrl-file: fftw_wisdom_dir should start with 'file://'" << std::endl;
+      }
+    }
+    if (ctrl["channel_extractor_threads"] != Json::Value()){
+      if (ctrl["channel_extractor_threads"].asInt() < 1){
+        ok = false;
+        writer << "Ctrl-file: channel_extractor_threads should be at least 1" << std::endl;
+      }
+    }
+  }
+
+  { // Check the options of the data readers
+    if (ctrl["file_io"] != Json::Value()){
+      const std::string file_io = ctrl["file_io"].asString();
+      if ((file_io != "mmap") && (file_io != "direct") && (file_io != "read") &&
+          (file_io != "striped")){
+        ok = false;
+        writer << "Ctrl-file: file_io should be \"mmap\", \"direct\", \"read\" or \"striped\"" << std::endl;
+      }
+    }
+    if (ctrl["stripe_threads"] != Json::Value()){
+      if (ctrl["stripe_threads"].asInt() < 1){
+        ok = false;
+        writer << "Ctrl-file: stripe_threads should be at least 1" << std::endl;
+      }
+    }
+    if (ctrl["file_readahead"] != Json::Value()){
+      if (ctrl["file_readahead"].asInt() < 0){
+        ok = false;
+        writer << "Ctrl-file: file_readahead should not be negative" << std::endl;
+      }
+    }
+  }
+
   { // Check stations and reference station
     if (ctrl["stations"] != Json::Value()) {
       std::set<std::string> stations_set;
@@ -378,9 +446,11 @@ Control_parameters::check(std::ostream &writer) const {
 	  if (sources.isObject()) {
 	    for (Json::Value::const_iterator source_it = sources.begin();
 		 source_it != sources.end(); source_it++)
-	      check_data_source(writer, *source_it);
+	      if (!check_data_source(writer, station_name, *source_it))
+		ok = false;
 	  } else {
-	    check_data_source(writer, sources);
+	    if (!check_data_source(writer, station_name, sources))
+	      ok = false;
 	  }
 	}
       }
@@ -665,6 +735,47 @@ Control_parameters::slices_per_integration() const {
   return ctrl["slices_per_integration"].asInt();
 }
 
+int
+Control_parameters::correlation_threads() const {
+  if (ctrl["correlation_threads"] == Json::Value())
+    return 1;
+
+  return ctrl["correlation_threads"].asInt();
+}
+
+int
+Control_parameters::bit2float_threads() const {
+  if (ctrl["bit2float_threads"] == Json::Value())
+    return 1;
+
+  return ctrl["bit2float_threads"].asInt();
+}
+
+std::string
+Control_parameters::fftw_wisdom_dir() const {
+  if (ctrl["fftw_wisdom_dir"] == Json::Value())
+    return std::string();
+
+  // Strip file://
+  return create_path(ctrl["fftw_wisdom_dir"].asString()).substr(7);
+}
+
+int
+Control_parameters::channel_extractor_threads() const {
+  if (ctrl["channel_extractor_threads"] == Json::Value())
+    return 1;
+
+  return ctrl["channel_extractor_threads"].asInt();
+}
+
+bool
+Control_parameters::data_index() const {
+  if (ctrl["data_index"] == Json::Value())
+    return true;
+
+  return ctrl["data_index"].asBool();
+}
+
 bool
 Control_parameters::exit_on_empty_datastream() const{
   return ctrl["exit_on_empty_datastream"].asBool();
@@ -1523,16 +1634,23 @@ get_vdif_datastreams(const std::string &mode,
     num_threads++;
   }
   int num_channels = 0;
+  std::map<std::string, int> channels_per_thread;
   for (Vex::Node::const_iterator channel_it = datastream->begin("channel");
        channel_it != datastream->end("channel"); channel_it++) {
     if (ds_name != channel_it[0]->to_string())
       continue;
+    channels_per_thread[channel_it[1]->to_string()]++;
     num_channels++;
   }
+  bool single_channel_threads = (num_threads == num_channels);
+  for (std::map<std::string, int>::const_iterator it = channels_per_thread.begin();
+       it != channels_per_thread.end(); it++)
+    single_channel_threads = single_channel_threads && (it->second == 1);
 
   // We can handle multi-thread, single-channel VDIF in a more
-  // efficient way as we don't need to do any unpacking.
-  if (num_threads == num_channels) {
+  // efficient way as we don't need to do any unpacking.  The frames
+  // are passed on to the data writers without copying them.
+  if (single_channel_threads) {
       input_parameters.n_tracks = 0;
       for (size_t ch_nr = 0; ch_nr < number_frequency_channels(); ch_nr++) {
 	const std::string &channel_name = frequency_channel(ch_nr, mode, station);
@@ -1635,14 +1753,21 @@ get_vdif_threads(const std::string &mode,
     num_threads++;
   }
   int num_channels = 0;
+  std::map<int, int> channels_per_thread;
   for (Vex::Node::const_iterator channel_it = thread->begin("channel");
        channel_it != thread->end("channel"); channel_it++) {
+    channels_per_thread[channel_it[1]->to_int()]++;
     num_channels++;
   }
+  bool single_channel_threads = (num_threads == num_channels);
+  for (std::map<int, int>::const_iterator it = channels_per_thread.begin();
+       it != channels_per_thread.end(); it++)
+    single_channel_threads = single_channel_threads && (it->second == 1);
 
   // We can handle multi-thread, single-channel VDIF in a more
-  // efficient way as we don't need to do any unpacking.
-  if (num_threads == num_channels) {
+  // efficient way as we don't need to do any unpacking.  The frames
+  // are passed on to the data writers without copying them.
+  if (single_channel_threads) {
       input_parameters.n_tracks = 0;
       for (size_t ch_nr = 0; ch_nr < number_frequency_channels(); ch_nr++) {
 	const std::string &channel_name = frequency_channel(ch_nr, mode, station);
@@ -1811,6 +1936,25 @@ get_mark5b_standard_mapping(const std::string &mode,
   }
 }
 
+Data_reader_parameters
+Control_parameters::get_data_reader_parameters() const {
+  Data_reader_parameters result;
+  if (ctrl["file_io"] != Json::Value()) {
+    const std::string file_io = ctrl["file_io"].asString();
+    if (file_io == "direct")
+      result.file_io = Data_reader_parameters::FILE_IO_DIRECT;
+    else if (file_io == "read")
+      result.file_io = Data_reader_parameters::FILE_IO_READ;
+    else if (file_io == "striped")
+      result.file_io = Data_reader_parameters::FILE_IO_STRIPED;
+  }
+  if (ctrl["file_readahead"] != Json::Value())
+    result.file_readahead = ctrl["file_readahead"].asInt();
+  if (ctrl["stripe_threads"] != Json::Value())
+    result.stripe_threads = ctrl["stripe_threads"].asInt();
+  return result;
+}
+
 Input_node_parameters
 Control_parameters::
 get_input_node_parameters(const std::string &mode_name,
@@ -1823,6 +1967,8 @@ get_input_node_parameters(const std::string &mode_name,
   result.overlap_time =  0;
   result.phasecal_integr_time = phasecal_integration_time();
   result.exit_on_empty_datastream = exit_on_empty_datastream();
+  result.channel_extractor_threads = channel_extractor_threads();
+  result.data_index = data_index();
 
   const Vex::Node &root = vex.get_root_node();
   Vex::Node::const_iterator mode = root["MODE"][mode_name];
@@ -2257,6 +2403,9 @@ get_correlation_parameters(const std::string &scan_name,
   corr_param.fft_size_delaycor = fft_size_delaycor();
   corr_param.fft_size_correlation = fft_size_correlation();
   corr_param.window = window_function();  
+  corr_param.correlation_threads = correlation_threads();
+  corr_param.bit2float_threads = bit2float_threads();
+  corr_param.fftw_wisdom_dir = fftw_wisdom_dir();
   corr_param.sample_rate = sample_rate(mode_name, station_name);
 
   corr_param.sideband = ' ';
@@ -2464,6 +2613,8 @@ operator<<(std::ostream &out,
            const Input_node_parameters &param) {
   out << "{ \"n_tracks\": " << param.n_tracks << ", "
       <<"\"track_bit_rate\": " << param.track_bit_rate << ", "
+      <<"\"channel_extractor_threads\": " << param.channel_extractor_threads << ", "
+      <<"\"data_index\": " << (param.data_index ? "true" : "false") << ", "
       << std::endl;
 
   out << " channels: [";
@@ -2552,6 +2703,12 @@ Correlation_parameters::operator==(const Correlation_parameters& other) const {
     return false;
   if (window != other.window)
     return false;
+  if (correlation_threads != other.correlation_threads)
+    return false;
+  if (bit2float_threads != other.bit2float_threads)
+    return false;
+  if (fftw_wisdom_dir != other.fftw_wisdom_dir)
+    return false;
   if (integration_nr != other.integration_nr)
     return false;
   if (slice_nr != other.slice_nr)
@@ -2583,6 +2740,9 @@ std::ostream &operator<<(std::ostream &out,
   out << "  \"fft_size_delaycor\": " << param.fft_size_delaycor << ", " << std::endl;
   out << "  \"fft_size_correlation\": " << param.fft_size_correlation << ", " << std::endl;
   out << "  \"window\": " << param.window << ", " << std::endl;
+  out << "  \"correlation_threads\": " << param.correlation_threads << ", " << std::endl;
+  out << "  \"bit2float_threads\": " << param.bit2float_threads << ", " << std::endl;
+  out << "  \"fftw_wisdom_dir\": \"" << param.fftw_wisdom_dir << "\", " << std::endl;
   out << "  \"slice_nr\": " << param.slice_nr << ", " << std::endl;
   out << "  \"sample_rate\": " << param.sample_rate << ", " << std::endl;
   out << "  \"channel_freq\": " << param.channel_freq << ", " << std::endl;
@@ -5,6 +5,154 @@
 #include <complex>
 #include <set>
 
+// Accumulates the correlation products of all baselines for a contiguous
+// range of frequencies
+class Correlation_core::Step_job : public Worker_pool::Job {
+public:
+  Step_job(Correlation_core &core_, std::vector<Complex_buffer> &integration_buffer_,
+           int nbuffer_, int stride_)
+    : core(core_), integration_buffer(integration_buffer_),
+      nbuffer(nbuffer_), stride(stride_) {}
+
+  void run(int part, int n_parts) {
+    // Split on cache lines to avoid false sharing of the accumulators
+    size_t begin, end;
+    Worker_pool::partition(core.fft_size() + 1, part, n_parts, begin, end,
+                           64 / sizeof(std::complex<FLOAT>));
+    core.integration_step(integration_buffer, nbuffer, stride, begin, end);
+  }
+
+private:
+  Correlation_core &core;
+  std::vector<Complex_buffer> &integration_buffer;
+  int nbuffer, stride;
+};
+
+// Adds the accumulation buffers to the phase centers, the baselines are
+// distributed round robin over the threads
+class Correlation_core::Sub_integration_job : public Worker_pool::Job {
+public:
+  Sub_integration_job(Correlation_core &core_,
+                      const std::vector< std::vector<double> > &ddelays_,
+                      const std::vector<double> &rates_)
+    : core(core_), ddelays(ddelays_), rates(rates_) {}
+
+  void run(int part, int n_parts) {
+    const size_t n_streams = core.number_input_streams();
+    const int n_phase_centers = core.phase_centers.size();
+    for (size_t i = part; i < core.baselines.size(); i += n_parts) {
+      Complex_buffer &accumulation_buffer = core.accumulation_buffers[i];
+      const int n_fft = accumulation_buffer.size();
+      if (i < n_streams) {
+        // Auto correlations
+        for (int j = 0; j < n_phase_centers; j++) {
+          for (int k = 0; k < n_fft; k++)
+            core.phase_centers[j][i][k] += accumulation_buffer[k];
+        }
+      } else {
+        std::pair<size_t, size_t> &baseline = core.baselines[i];
+        // The pointing center
+        for (int k = 0; k < n_fft; k++)
+          core.phase_centers[0][i][k] += accumulation_buffer[k];
+        // UV shift the additional phase centers
+        for (int j = 1; j < n_phase_centers; j++) {
+          core.uvshift(accumulation_buffer, core.phase_centers[j][i],
+                       ddelays[baseline.first][j], ddelays[baseline.second][j],
+                       rates[baseline.first], rates[baseline.second]);
+        }
+      }
+      // Clear the accumulation buffer
+      memset(&accumulation_buffer[0], 0, n_fft * sizeof(std::complex<FLOAT>));
+    }
+  }
+
+private:
+  Correlation_core &core;
+  const std::vector< std::vector<double> > &ddelays;
+  const std::vector<double> &rates;
+};
+
+// Normalises either the auto correlations (computing norms) or the cross
+// correlations (using norms)
+class Correlation_core::Normalize_job : public Worker_pool::Job {
+public:
+  Normalize_job(Correlation_core &core_, std::vector<Complex_buffer> &integration_buffer_,
+                std::vector<double> &norms_, const std::vector<int64_t> &n_invalid_,
+                bool autos_)
+    : core(core_), integration_buffer(integration_buffer_), norms(norms_),
+      n_invalid(n_invalid_), autos(autos_) {}
+
+  void run(int part, int n_parts) {
+    const size_t n_streams = core.number_input_streams();
+    const size_t n_fft = core.fft_size() + 1;
+    if (autos) {
+      for (size_t i = part; i < n_streams; i += n_parts) {
+        for (size_t j = 0; j < n_fft; j++) {
+          norms[i] += integration_buffer[i][j].real();
+        }
+        norms[i] /= core.fft_size();
+        if (norms[i] < 1)
+          norms[i] = 1;
+
+        for (size_t j = 0; j < n_fft; j++) {
+          // imaginary part should be zero!
+          integration_buffer[i][j] =
+            integration_buffer[i][j].real() / norms[i];
+        }
+      }
+      return;
+    }
+
+    const int64_t total_samples = core.number_ffts_in_slice * core.fft_size();
+    for (size_t i = n_streams + part; i < core.baselines.size(); i += n_parts) {
+      std::pair<size_t, size_t> &baseline = core.baselines[i];
+      int64_t n_valid1 =  total_samples - n_invalid[baseline.first];
+      int64_t n_valid2 =  total_samples - n_invalid[baseline.second];
+      double N1 = n_valid1 > 0? 1 - core.n_flagged[i].first  * 1. / n_valid1 : 1;
+      double N2 = n_valid2 > 0? 1 - core.n_flagged[i].second * 1. / n_valid2 : 1;
+      double N = N1 * N2;
+      if (N < 0.01) N = 1;
+      FLOAT norm = sqrt(N * norms[baseline.first] * norms[baseline.second]);
+      for (size_t j = 0 ; j < n_fft; j++) {
+        integration_buffer[i][j] /= norm;
+      }
+    }
+  }
+
+private:
+  Correlation_core &core;
+  std::vector<Complex_buffer> &integration_buffer;
+  std::vector<double> &norms;
+  // Number of invalid samples per input stream
+  const std::vector<int64_t> &n_invalid;
+  bool autos;
+};
+
+// Computes the output spectra of all baselines, every thread uses its own
+// fft plans and scratch buffers
+class Correlation_core::Output_job : public Worker_pool::Job {
+public:
+  Output_job(Correlation_core &core_, std::vector<Complex_buffer> &integration_buffer_)
+    : core(core_), integration_buffer(integration_buffer_) {}
+
+  void run(int part, int n_parts) {
+    // The spectra are computed in batches of up to OUTPUT_FFT_BATCH baselines
+    std::vector<size_t> batch;
+    for (size_t i = part; i < core.baselines.size(); i += n_parts) {
+      batch.push_back(i);
+      if ((batch.size() == OUTPUT_FFT_BATCH) ||
+          (i + n_parts >= core.baselines.size())) {
+        core.output_spectra(integration_buffer, batch, *core.output_buffers[part]);
+        batch.clear();
+      }
+    }
+  }
+
+private:
+  Correlation_core &core;
+  std::vector<Complex_buffer> &integration_buffer;
+};
+
 Correlation_core::Correlation_core()
   : current_fft(0), total_ffts(0), n_phase_centre_written(0), 
     tsys_written(false) {
@@ -33,8 +181,6 @@ void Correlation_core::do_task() {
   for (size_t i = 0; i < number_input_streams(); i++) {
     int stream = station_stream(i);
     input_elements[i] = &input_buffers[stream]->front()->data[0];
-    if (input_buffers[stream]->front()->data.size() > input_conj_buffers[i].size())
-      input_conj_buffers[i].resize(input_buffers[stream]->front()->data.size());
   }
   const int first_stream = station_stream(0);
   const int stride = input_buffers[first_stream]->front()->stride;
@@ -127,10 +273,8 @@ Correlation_core::set_parameters(const Correlation_parameters &parameters,
   if (input_elements.size() != number_input_streams()) {
     input_elements.resize(number_input_streams());
   }
-  if (input_conj_buffers.size() != number_input_streams()) {
-    input_conj_buffers.resize(number_input_streams());
-  }
   n_flagged.resize(baselines.size());
+  workers.resize(parameters.correlation_threads);
 }
 
 void
@@ -225,10 +369,7 @@ void Correlation_core::integration_initialise() {
   memset(&n_flagged[0], 0, sizeof(std::pair<int64_t, int64_t>) * n_flagged.size());
   next_sub_integration = 1;
 
-  fft_f2t.resize(2 * fft_size());
-  fft_t2f.resize(2 * number_channels());
-  temp_buffer.resize(fft_size() + 1);
-  real_buffer.resize(2 * fft_size());
+  initialise_output_buffers();
 
   if (phase_centers.size() > 1)
     create_weights();
@@ -239,79 +380,93 @@ void Correlation_core::integration_initialise() {
   }
 }
 
+void Correlation_core::initialise_output_buffers() {
+  if (output_buffers.size() != (size_t)workers.size())
+    output_buffers.resize(workers.size());
+
+  for (size_t i = 0; i < output_buffers.size(); i++) {
+    if (output_buffers[i] == shared_ptr<Output_buffers>())
+      output_buffers[i] = shared_ptr<Output_buffers>(new Output_buffers());
+    Output_buffers &buffers = *output_buffers[i];
+    if (buffers.fft_f2t.size != 2 * fft_size())
+      buffers.fft_f2t.resize(2 * fft_size());
+    if (buffers.fft_t2f.size != 2 * number_channels())
+      buffers.fft_t2f.resize(2 * number_channels());
+    buffers.temp_buffer.resize(OUTPUT_FFT_BATCH * (fft_size() + 1));
+    buffers.real_buffer.resize(OUTPUT_FFT_BATCH * 2 * fft_size());
+  }
+}
+
 void Correlation_core::integration_step(std::vector<Complex_buffer> &integration_buffer, int nbuffer, int stride) {
-#ifndef DUMMY_CORRELATION
-  SFXC_ASSERT(nbuffer * stride <= input_conj_buffers[0].size());
+  Step_job job(*this, integration_buffer, nbuffer, stride);
+  workers.run(job);
+}
 
-  // Auto correlations
-  for (size_t i = 0; i < number_input_streams(); i++) {
-    for (size_t buf_idx = 0; buf_idx < nbuffer * stride; buf_idx += stride) {
-      // get the complex conjugates of the input
-      SFXC_CONJ_FC(&input_elements[i][buf_idx], &(input_conj_buffers[i])[buf_idx], fft_size() + 1);
-      SFXC_ADD_PRODUCT_FC(/* in1 */ &input_elements[i][buf_idx], 
-			  /* in2 */ &input_conj_buffers[i][buf_idx],
-			  /* out */ &integration_buffer[i][0], fft_size() + 1);
+void Correlation_core::integration_step(std::vector<Complex_buffer> &integration_buffer, int nbuffer, int stride,
+                                        size_t begin, size_t end) {
+#ifndef DUMMY_CORRELATION
+  const size_t n_streams = number_input_streams();
+  const size_t tile = tile_size(nbuffer);
+
+  // Walk the spectrum in frequency tiles, every baseline is accumulated for
+  // a tile before moving on to the next one. This way each station spectrum
+  // is read from memory once instead of once per baseline. Within a tile the
+  // order of the accumulations is the same as when correlating the baselines
+  // one after the other, so the results are identical.
+  for (size_t tile_start = begin; tile_start < end; tile_start += tile) {
+    const size_t len = std::min(tile, end - tile_start);
+
+    // Auto correlations
+    for (size_t i = 0; i < n_streams; i++) {
+      for (size_t buf_idx = tile_start; buf_idx < nbuffer * stride; buf_idx += stride) {
+        SFXC_ADD_PRODUCT_CONJ_FC(/* in1 */ &input_elements[i][buf_idx], 
+                                 /* in2 */ &input_elements[i][buf_idx],
+                                 /* out */ &integration_buffer[i][tile_start], len);
+      }
     }
-  }
 
-  // Cross correlations
-  for (size_t i = number_input_streams(); i < baselines.size(); i++) {
-    for (size_t buf_idx = 0; buf_idx < nbuffer * stride; buf_idx += stride) {
+    // Cross correlations
+    for (size_t i = n_streams; i < baselines.size(); i++) {
       std::pair<size_t, size_t> &baseline = baselines[i];
       SFXC_ASSERT(baseline.first != baseline.second);
-      if ((i % 2) == 0 || 1) {
-      SFXC_ADD_PRODUCT_FC(/* in1 */ &input_elements[baseline.first][buf_idx], 
-			  /* in2 */ &input_conj_buffers[baseline.second][buf_idx],
-			  /* out */ &integration_buffer[i][0], fft_size() + 1);
-      } else {
-      SFXC_ADD_PRODUCT_FC(/* in1 */ &input_conj_buffers[baseline.first][buf_idx], 
-			  /* in2 */ &input_elements[baseline.second][buf_idx],
-			  /* out */ &integration_buffer[i][0], fft_size() + 1);
+      for (size_t buf_idx = tile_start; buf_idx < nbuffer * stride; buf_idx += stride) {
+        SFXC_ADD_PRODUCT_CONJ_FC(/* in1 */ &input_elements[baseline.first][buf_idx], 
+                                 /* in2 */ &input_elements[baseline.second][buf_idx],
+                                 /* out */ &integration_buffer[i][tile_start], len);
       }
     }
   }
 #endif // DUMMY_CORRELATION
 }
 
+size_t Correlation_core::tile_size(int nbuffer) {
+  // Per frequency point a tile touches the input of every fft in the buffer
+  // and one accumulator per baseline
+  const size_t n_vectors = number_input_streams() * nbuffer + baselines.size();
+  size_t tile = CORRELATOR_TILE_BYTES / (n_vectors * sizeof(std::complex<FLOAT>));
+  // Keep the tiles a multiple of a cache line
+  const size_t align = 64 / sizeof(std::complex<FLOAT>);
+  tile = std::max(tile - tile % align, 4 * align);
+  return std::min(tile, fft_size() + 1);
+}
+
 void Correlation_core::integration_normalize(std::vector<Complex_buffer> &integration_buffer) {
   std::vector<double> norms(number_input_streams());
   memset(&norms[0], 0, norms.size() * sizeof(double));
-  // Normalize the auto correlations
-  for (size_t i = 0; i < number_input_streams(); i++) {
-    for (size_t j = 0; j < fft_size() + 1; j++) {
-      norms[i] += integration_buffer[i][j].real();
-    }
-    norms[i] /= fft_size();
-    if (norms[i] < 1)
-      norms[i] = 1;
-
-    for (size_t j = 0; j < fft_size() + 1; j++) {
-      // imaginary part should be zero!
-      integration_buffer[i][j] =
-        integration_buffer[i][j].real() / norms[i];
-    }
-  }
-
-  // Normalize the cross correlations
-  const int64_t total_samples = number_ffts_in_slice * fft_size();
-  for (size_t i = number_input_streams(); i < baselines.size(); i++) {
-    std::pair<size_t, size_t> &baseline = baselines[i];
-    int stream1 = station_stream(baseline.first);
-    int stream2 = station_stream(baseline.second);
-    int64_t *levels1 = statistics[stream1]->get_statistics(); 
-    int64_t *levels2 = statistics[stream2]->get_statistics();
+  // get_statistics() is not thread safe and several baselines share a
+  // station, so collect the number of invalid samples beforehand
+  std::vector<int64_t> n_invalid(number_input_streams());
+  for (size_t i = 0; i < n_invalid.size(); i++) {
     // levels[4] contains the number of invalid samples
-    int64_t n_valid1 =  total_samples - levels1[4]; 
-    int64_t n_valid2 =  total_samples - levels2[4];
-    double N1 = n_valid1 > 0? 1 - n_flagged[i].first  * 1. / n_valid1 : 1;
-    double N2 = n_valid2 > 0? 1 - n_flagged[i].second * 1. / n_valid2 : 1;
-    double N = N1 * N2;
-    if (N < 0.01) N = 1;
-    FLOAT norm = sqrt(N * norms[baseline.first] * norms[baseline.second]);
-    for (size_t j = 0 ; j < fft_size() + 1; j++) {
-      integration_buffer[i][j] /= norm;
-    }
+    int64_t *levels = statistics[station_stream(i)]->get_statistics();
+    n_invalid[i] = levels[4];
   }
+  // Normalize the auto correlations
+  Normalize_job autos(*this, integration_buffer, norms, n_invalid, true);
+  workers.run(autos);
+  // Normalize the cross correlations, this needs the norms of the autos
+  Normalize_job crosses(*this, integration_buffer, norms, n_invalid, false);
+  workers.run(crosses);
 }
 
 void Correlation_core::integration_write(std::vector<Complex_buffer> &integration_buffer, int phase_center, int source, int bin, double binweight /* = 1. */) {
@@ -409,7 +564,16 @@ void Correlation_core::integration_write(std::vector<Complex_buffer> &integratio
   }
 
   SFXC_ASSERT(fft_size() >= number_channels());
-  integration_buffer_float.resize(number_channels() + 1);
+  SFXC_ASSERT(output_buffers.size() >= (size_t)workers.size());
+  if (integration_buffers_float.size() != baselines.size())
+    integration_buffers_float.resize(baselines.size());
+  for (size_t i = 0; i < baselines.size(); i++)
+    integration_buffers_float[i].resize(number_channels() + 1);
+
+  // Compute the spectra of all baselines in parallel, they are written
+  // in order below
+  Output_job job(*this, integration_buffer);
+  workers.run(job);
 
   Output_header_baseline hbaseline;
   for (size_t i = 0; i < baselines.size(); i++) {
@@ -417,33 +581,6 @@ void Correlation_core::integration_write(std::vector<Complex_buffer> &integratio
     int stream1 = station_stream(baseline.first);
     int stream2 = station_stream(baseline.second);
 
-    if (fft_size() != number_channels()) {
-      if (mask_parameters.normalize) {
-	for (size_t j = 0; j < fft_size() + 1; j++) {
-	  if (abs(integration_buffer[i][j]) != 0.0)
-	    integration_buffer[i][j] /= abs(integration_buffer[i][j]);
-	}
-      }
-      SFXC_MUL_F_FC_I(&mask[0], &integration_buffer[i][0], fft_size() + 1);
-      fft_f2t.irfft(&integration_buffer[i][0], &real_buffer[0]);
-      real_buffer[number_channels()] =
-	(real_buffer[number_channels()] +
-	 real_buffer[2 * fft_size() - number_channels()]) / 2;
-      for (size_t j = 1; j < number_channels(); j++)
-	real_buffer[number_channels() + j] =
-	  real_buffer[2 * fft_size() - number_channels() + j];
-      SFXC_MUL_F(&real_buffer[0], &window[0], &real_buffer[0],
-		 2 * number_channels());
-      fft_t2f.rfft(&real_buffer[0], &temp_buffer[0]);
-      for (size_t j = 0; j < number_channels() + 1; j++) {
-	integration_buffer_float[j] = temp_buffer[j];
-	integration_buffer_float[j] /= (2 * fft_size());
-      }
-    } else {
-      for (size_t j = 0; j < number_channels() + 1; j++)
-	integration_buffer_float[j] = integration_buffer[i][j];
-    }
-
     int64_t *levels = statistics[stream1]->get_statistics(); // We get the number of invalid samples from the bitstatistics
     const int64_t total_samples = number_ffts_in_slice * fft_size();
     int64_t valid_samples;
@@ -478,7 +615,62 @@ void Correlation_core::integration_write(std::vector<Complex_buffer> &integratio
     int nWrite = sizeof(hbaseline);
     writer->put_bytes(nWrite, (char *)&hbaseline);
     writer->put_bytes((number_channels() + 1) * sizeof(std::complex<float>),
-                      ((char*)&integration_buffer_float[0]));
+                      ((char*)&integration_buffers_float[i][0]));
+  }
+}
+
+void
+Correlation_core::output_spectra(std::vector<Complex_buffer> &input,
+                                 const std::vector<size_t> &batch,
+                                 Output_buffers &scratch) {
+  SFXC_ASSERT(batch.size() <= OUTPUT_FFT_BATCH);
+  const int n = batch.size();
+  if (fft_size() != number_channels()) {
+    // All spectra in the batch are transformed at once
+    const size_t complex_stride = fft_size() + 1;
+    const size_t real_stride = 2 * fft_size();
+    for (int k = 0; k < n; k++) {
+      Complex_buffer &spectrum = input[batch[k]];
+      if (mask_parameters.normalize) {
+        for (size_t j = 0; j < fft_size() + 1; j++) {
+          if (abs(spectrum[j]) != 0.0)
+            spectrum[j] /= abs(spectrum[j]);
+        }
+      }
+      SFXC_MUL_F_FC_I(&mask[0], &spectrum[0], fft_size() + 1);
+      memcpy(&scratch.temp_buffer[k * complex_stride], &spectrum[0],
+             (fft_size() + 1) * sizeof(std::complex<FLOAT>));
+    }
+    scratch.fft_f2t.irfft_many(&scratch.temp_buffer[0], complex_stride,
+                               &scratch.real_buffer[0], real_stride, n);
+    for (int k = 0; k < n; k++) {
+      FLOAT *real_buffer = &scratch.real_buffer[k * real_stride];
+      real_buffer[number_channels()] =
+        (real_buffer[number_channels()] +
+         real_buffer[2 * fft_size() - number_channels()]) / 2;
+      for (size_t j = 1; j < number_channels(); j++)
+        real_buffer[number_channels() + j] =
+          real_buffer[2 * fft_size() - number_channels() + j];
+      SFXC_MUL_F(&real_buffer[0], &window[0], &real_buffer[0],
+                 2 * number_channels());
+    }
+    scratch.fft_t2f.rfft_many(&scratch.real_buffer[0], real_stride,
+                              &scratch.temp_buffer[0], complex_stride, n);
+    for (int k = 0; k < n; k++) {
+      Complex_buffer_float &output = integration_buffers_float[batch[k]];
+      std::complex<FLOAT> *spectrum = &scratch.temp_buffer[k * complex_stride];
+      for (size_t j = 0; j < number_channels() + 1; j++) {
+        output[j] = spectrum[j];
+        output[j] /= (2 * fft_size());
+      }
+    }
+  } else {
+    for (int k = 0; k < n; k++) {
+      Complex_buffer &spectrum = input[batch[k]];
+      Complex_buffer_float &output = integration_buffers_float[batch[k]];
+      for (size_t j = 0; j < number_channels() + 1; j++)
+        output[j] = spectrum[j];
+    }
   }
 }
 
@@ -525,42 +717,25 @@ Correlation_core::sub_integration(){
   tfft.inc_samples(fft_size());
   const Time tmid = correlation_parameters.slice_start + tfft*(previous_fft+(current_fft-previous_fft)/2.); 
 
-  // Start with the auto correlations
-  const int n_fft = fft_size() + 1;
+  // Evaluate the delay model up front, the delay tables can not be used
+  // from several threads at once
+  const size_t n_streams = number_input_streams();
   const int n_phase_centers = phase_centers.size();
-  for (int i = 0; i < number_input_streams(); i++) {
-    for (int j = 0; j < n_phase_centers; j++) {
-      for (int k = 0; k < n_fft; k++) {
-        phase_centers[j][i][k] += accumulation_buffers[i][k];
-      }
+  std::vector< std::vector<double> > ddelays(n_streams);
+  std::vector<double> rates(n_streams);
+  if (n_phase_centers > 1) {
+    for (size_t i = 0; i < n_streams; i++) {
+      Delay_table_akima &delay_table = delay_tables[station_stream(i)];
+      double delay = delay_table.delay(tmid);
+      ddelays[i].resize(n_phase_centers);
+      for (int j = 1; j < n_phase_centers; j++)
+        ddelays[i][j] = delay_table.delay(tmid, j) - delay;
+      rates[i] = delay_table.rate(tmid);
     }
   }
 
-  for (int i = number_input_streams(); i < baselines.size(); i++) {
-    std::pair<size_t, size_t> &baseline = baselines[i];
-    int stream1 = station_stream(baseline.first);
-    int stream2 = station_stream(baseline.second);
-
-    // The pointing center
-    for(int j = 0; j < n_fft; j++)
-      phase_centers[0][i][j] += accumulation_buffers[i][j];
-    // UV shift the additional phase centers
-    for(int j = 1; j < n_phase_centers; j++) {
-      double delay1 = delay_tables[stream1].delay(tmid);
-      double delay2 = delay_tables[stream2].delay(tmid);
-      double ddelay1 = delay_tables[stream1].delay(tmid, j) - delay1;
-      double ddelay2 = delay_tables[stream2].delay(tmid, j) - delay2;
-      double rate1 = delay_tables[stream1].rate(tmid);
-      double rate2 = delay_tables[stream2].rate(tmid);
-      uvshift(accumulation_buffers[i], phase_centers[j][i], ddelay1, ddelay2, rate1, rate2);
-    }
-  }
-  // Clear the accumulation buffers
-  for (size_t i = 0; i < accumulation_buffers.size(); i++) {
-    SFXC_ASSERT(accumulation_buffers[i].size() == n_fft);
-    size_t size = accumulation_buffers[i].size() * sizeof(std::complex<FLOAT>);
-    memset(&accumulation_buffers[i][0], 0, size);
-  }
+  Sub_integration_job job(*this, ddelays, rates);
+  workers.run(job);
   previous_fft = current_fft;
 }
 
@@ -578,23 +753,8 @@ Correlation_core::uvshift(const Complex_buffer &input_buffer, Complex_buffer &ou
   double phi = base_freq * (ddelay1 * (1 - rate1) - ddelay2 * (1 - rate2));
   phi = 2 * M_PI * sb * (phi - floor(phi));
   double delta = 2 * M_PI * dfreq * (ddelay1 * (1 - rate1) - ddelay2 * (1 - rate2));
-  double temp=sin(delta/2);
-  const double a=2*temp*temp,b=sin(delta);
-  double cos_phi, sin_phi;
-#ifdef HAVE_SINCOS
-  sincos(phi, &sin_phi, &cos_phi);
-#else
-  sin_phi = sin(phi);
-  cos_phi = cos(phi);
-#endif 
   const int size = input_buffer.size();
-  for (int i = 0; i < size; i++) {
-    output_buffer[i] += amplitude * input_buffer[i] * std::complex<FLOAT>(cos_phi, sin_phi);
-    // Compute sin_phi=sin(phi); cos_phi = cos(phi);
-    temp=sin_phi-(a*sin_phi-b*cos_phi);
-    cos_phi=cos_phi-(a*cos_phi+b*sin_phi);
-    sin_phi=temp;
-  }
+  SFXC_ADD_ROTATED_FC(&input_buffer[0], &output_buffer[0], size, phi, delta, amplitude);
 }
 
 void Correlation_core::add_source_list(const std::map<std::string, int> &sources_){
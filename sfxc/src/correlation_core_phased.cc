@@ -69,12 +69,8 @@ Correlation_core_phased::set_parameters(const Correlation_parameters &parameters
   if (input_elements.size() != number_input_streams()) {
     input_elements.resize(number_input_streams());
   }
-  if (input_conj_buffers.size() != number_input_streams()) {
-    input_conj_buffers.resize(number_input_streams());
-    for(int i = 0; i < number_input_streams(); i++)
-      input_conj_buffers[i].resize(fft_size() + 1);
-  }
   n_flagged.resize(baselines.size());
+  workers.resize(parameters.correlation_threads);
 }
 
 void
@@ -112,6 +108,7 @@ void Correlation_core_phased::integration_initialise() {
   }
 
   memset(&n_flagged[0], 0, sizeof(std::pair<int64_t,int64_t>)*n_flagged.size());
+  initialise_output_buffers();
 }
 
 void Correlation_core_phased::integration_step(std::vector<Complex_buffer> &integration_buffer, int buf_idx) {
@@ -38,10 +38,8 @@ Correlation_core_pulsar::set_parameters(const Correlation_parameters &parameters
   if (input_elements.size() != number_input_streams()) {
     input_elements.resize(number_input_streams());
   }
-  if (input_conj_buffers.size() != number_input_streams()) {
-    input_conj_buffers.resize(number_input_streams());
-  }
   n_flagged.resize(baselines.size());
+  workers.resize(parameters.correlation_threads);
 
   double start_mjd = parameters.slice_start.get_mjd();
   fft_duration = ((double)fft_size() * 1000000) / parameters.sample_rate;
@@ -116,8 +114,6 @@ void Correlation_core_pulsar::do_task() {
   for (size_t i = 0; i < number_input_streams(); i++) {
     int stream = station_stream(i);
     input_elements[i] = &input_buffers[stream]->front()->data[0];
-    if (input_buffers[stream]->front()->data.size() > input_conj_buffers[i].size())
-      input_conj_buffers[i].resize(input_buffers[stream]->front()->data.size());
   }
   const int first_stream = station_stream(0);
   const int stride = input_buffers[first_stream]->front()->stride;
@@ -180,10 +176,7 @@ void Correlation_core_pulsar::integration_initialise() {
     memset(&dedispersion_buffer[j][0], 0, size * sizeof(std::complex<FLOAT>));
   }
   memset(&n_flagged[0], 0, sizeof(std::pair<int64_t,int64_t>)*n_flagged.size());
-  fft_f2t.resize(2 * fft_size());
-  fft_t2f.resize(2 * number_channels());
-  temp_buffer.resize(fft_size() + 1);
-  real_buffer.resize(2 * fft_size());
+  initialise_output_buffers();
 
   if (fft_size() != number_channels()){
     create_mask();
@@ -195,20 +188,18 @@ void Correlation_core_pulsar::integration_step(std::vector<Complex_buffer> &inte
 #ifndef DUMMY_CORRELATION
   // Auto correlations
   for (size_t i = 0; i < number_input_streams(); i++) {
-    // get the complex conjugates of the input
-    SFXC_CONJ_FC(&input_elements[i][buf_idx], &(input_conj_buffers[i])[0], fft_size() + 1);
-    SFXC_ADD_PRODUCT_FC(/* in1 */ &input_elements[i][buf_idx], 
-                        /* in2 */ &input_conj_buffers[i][0],
-                        /* out */ &integration_buffer[i][0], fft_size() + 1);
+    SFXC_ADD_PRODUCT_CONJ_FC(/* in1 */ &input_elements[i][buf_idx], 
+                             /* in2 */ &input_elements[i][buf_idx],
+                             /* out */ &integration_buffer[i][0], fft_size() + 1);
   }
   
   // Cross correlations
   for (size_t i = number_input_streams(); i < baselines.size(); i++) {
     std::pair<size_t, size_t> &baseline = baselines[i];
     SFXC_ASSERT(baseline.first != baseline.second);
-    SFXC_ADD_PRODUCT_FC(/* in1 */ &input_elements[baseline.first][buf_idx], 
-                        /* in2 */ &input_conj_buffers[baseline.second][0],
-                        /* out */ &integration_buffer[i][0], fft_size() + 1);
+    SFXC_ADD_PRODUCT_CONJ_FC(/* in1 */ &input_elements[baseline.first][buf_idx], 
+                             /* in2 */ &input_elements[baseline.second][buf_idx],
+                             /* out */ &integration_buffer[i][0], fft_size() + 1);
   }
 #endif // DUMMY_CORRELATION
 }
@@ -21,7 +21,8 @@ Correlator_node::Correlator_node(int rank, int nr_corr_node, bool pulsar_binning
     status(CORRELATING),
     pulsar_binning(pulsar_binning_),
     pulsar_parameters(get_log_writer()),
-    tasklet(nr_corr_node, pulsar_binning_, phased_array_) {
+    tasklet(nr_corr_node, pulsar_binning_, phased_array_),
+    fft_wisdom_loaded(false) {
   #ifdef USE_IPP
   ippSetNumThreads(1);
   #endif
@@ -41,6 +42,22 @@ Correlator_node::Correlator_node(int rank, int nr_corr_node, bool pulsar_binning
 Correlator_node::~Correlator_node() {
 }
 
+void Correlator_node::load_fft_wisdom(const std::string &wisdom_dir) {
+  // The fft plans can be tuned in advance with sfxc-fft-tune, the wisdom
+  // is stored in the directory given by fftw_wisdom_dir in the ctrl file.
+  // The nodes only read it, the tuned file is never overwritten.
+  if (wisdom_dir.empty())
+    return;
+  const std::string fft_wisdom_file = SFXC_FFT::wisdom_filename(wisdom_dir);
+  if (fft_wisdom_file.empty())
+    return;
+  if (SFXC_FFT::import_wisdom(fft_wisdom_file)) {
+    DEBUG_MSG("Loaded fft wisdom from " << fft_wisdom_file);
+  } else {
+    DEBUG_MSG("Could not load fft wisdom from " << fft_wisdom_file);
+  }
+}
+
 void Correlator_node::start_threads() {
   tasklet.start();
 }
@@ -94,6 +111,11 @@ Correlator_node::add_source_list(const std::map<std::string, int> &sources) {
 
 void
 Correlator_node::receive_parameters(const Correlation_parameters &parameters) {
+  // Nothing has been planned before the first slice
+  if (!fft_wisdom_loaded) {
+    load_fft_wisdom(parameters.fftw_wisdom_dir);
+    fft_wisdom_loaded = true;
+  }
   tasklet.add_new_slice(parameters);
 }
 
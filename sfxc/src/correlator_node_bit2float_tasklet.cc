@@ -1,10 +1,8 @@
-#include <sched.h>
 #include "correlator_node_bit2float_tasklet.h"
 #include "bit_statistics.h"
 
-#define MINIMUM_PROCESSED_SAMPLES 1024
-
-Correlator_node_bit2float_tasklet::Correlator_node_bit2float_tasklet() {}
+Correlator_node_bit2float_tasklet::Correlator_node_bit2float_tasklet()
+  : n_threads_(1), notifier_(NULL) {}
 
 Correlator_node_bit2float_tasklet::~Correlator_node_bit2float_tasklet() {}
 
@@ -16,27 +14,50 @@ void Correlator_node_bit2float_tasklet::empty_input_queue(){
 
 void Correlator_node_bit2float_tasklet::stop(){
   isrunning_=false;
+  notifier_->notify();
+}
+
+void Correlator_node_bit2float_tasklet::set_number_of_threads(int n_threads){
+  SFXC_ASSERT(n_threads >= 1);
+  n_threads_ = n_threads;
+}
+
+void Correlator_node_bit2float_tasklet::set_notifier(Notifier *notifier){
+  notifier_ = notifier;
 }
 
 void Correlator_node_bit2float_tasklet::do_execute(){
-  int processed_samples;
+  SFXC_ASSERT(notifier_ != NULL);
   data_processed_=0;
 
   timer_.start();
+  threads_.resize(n_threads_ - 1);
+  for (size_t i = 0; i < threads_.size(); i++) {
+    threads_[i] = Bit2float_thread_ptr(new Bit2float_thread(*this, i + 1));
+    threadpool_.register_thread( threads_[i]->start() );
+  }
+  process_streams(0);
+  // stop() has woken up the other threads as well
+  threadpool_.wait_for_all_termination();
+  timer_.stop();
+}
+
+void Correlator_node_bit2float_tasklet::process_streams(int thread_nr){
   while ( isrunning_ ){
-    processed_samples=0;
-    for (size_t i=0; i<bit2float_workers_.size(); i++) {
+    // Read the count before checking for work, so that data which arrives
+    // in the meantime wakes us up
+    unsigned int count = notifier_->count();
+    int processed_samples=0;
+    for (size_t i=thread_nr; i<bit2float_workers_.size(); i+=n_threads_) {
       if (bit2float_workers_[i]->has_work()) {
         processed_samples += bit2float_workers_[i]->do_task();
       }
     }
-    if ( processed_samples < MINIMUM_PROCESSED_SAMPLES ){
-      //sched_yield();
-      usleep(1000);
-    }
+    if ( processed_samples == 0 )
+      notifier_->wait(count);
   }
-  timer_.stop();
 }
+
 size_t Correlator_node_bit2float_tasklet::number_channel(){
   return bit2float_workers_.size();
 }
@@ -58,6 +79,7 @@ Correlator_node_bit2float_tasklet::set_parameters(const Correlation_parameters &
                                                   std::vector<Delay_table_akima> &delays){
   for(int i=0; i<bit2float_workers_.size(); i++)
     bit2float_workers_[i]->set_new_parameters(param, delays[i]);
+  notifier_->notify();
 }
 
 Bit2float_worker::Output_queue_ptr
@@ -79,6 +101,7 @@ Correlator_node_bit2float_tasklet::bit2float_workers() {
 
 void Correlator_node_bit2float_tasklet::get_state(std::ostream &out) {
   out << "\t\"Correlator_node_bit2float_tasklet\": {\n"
+      << "\t\t\"n_threads\": " << n_threads_ << ",\n"
       << "\t\t\"Bit2float_worker\": [\n";
       for (int i=0; i<bit2float_workers_.size(); i++) {
         bit2float_workers_[i]->get_state(out);
@@ -2,7 +2,7 @@
 
 Correlator_node_data_reader_tasklet::
 Correlator_node_data_reader_tasklet()
-  : input_buffer(37100000), bytes_left(0), stream_nr(-1),
+  : input_buffer(INPUT_BUFFER_SIZE), notifier(NULL), bytes_left(0), stream_nr(-1),
     new_stream_available(false),state(IDLE) {
 }
 
@@ -27,8 +27,9 @@ get_output_buffer() {
 void
 Correlator_node_data_reader_tasklet::do_task() {
   uint8_t header;
-  std::vector<unsigned char> &data = input_buffer.data;
-  size_t dsize = data.size();
+  unsigned char *data = input_buffer.data;
+  const uint64_t mask = input_buffer.mask;
+  const size_t dsize = input_buffer.size;
 
   uint64_t read = input_buffer.read;
   uint64_t write = input_buffer.write;
@@ -46,14 +47,14 @@ Correlator_node_data_reader_tasklet::do_task() {
   case PROCESSING_STREAM:
     breader_->get_bytes(sizeof(header), (char *)&header);
     SFXC_ASSERT(write < (read + dsize - 3));
-    data[write++ % dsize] = header;
+    data[write++ & mask] = header;
     switch (header) {
     case HEADER_DATA:
     {
       uint16_t nbytes;
       breader_->get_bytes(sizeof(nbytes), (char *)&nbytes);
-      data[write++ % dsize] = nbytes & 0xff;
-      data[write++ % dsize] = nbytes >> 8;
+      data[write++ & mask] = nbytes & 0xff;
+      data[write++ & mask] = nbytes >> 8;
       bytes_left = nbytes;
       SFXC_ASSERT(nbytes > 0);
       state = RECEIVE_DATA;
@@ -63,15 +64,15 @@ Correlator_node_data_reader_tasklet::do_task() {
     {
       int8_t new_delay;
       breader_->get_bytes(sizeof(new_delay), (char *)&new_delay);
-      data[write++ % dsize] = new_delay;
+      data[write++ & mask] = new_delay;
       break;
     }
     case HEADER_INVALID:
     {
       uint16_t n_invalid;
       breader_->get_bytes(sizeof(n_invalid), (char *)&n_invalid);
-      data[write++ % dsize] = n_invalid & 0xff;
-      data[write++ % dsize] = n_invalid >> 8;
+      data[write++ & mask] = n_invalid & 0xff;
+      data[write++ & mask] = n_invalid >> 8;
       break;
     }
     case HEADER_ENDSTREAM:
@@ -85,15 +86,10 @@ Correlator_node_data_reader_tasklet::do_task() {
     if (bytes_left > 0) {
       size_t bytes_left_in_buffer = dsize + (read - write);
       size_t to_read = std::min(bytes_left, bytes_left_in_buffer - 1);
-      size_t data_read = 0;
-      while (data_read < to_read) {
-        size_t data_to_read = std::min(to_read - data_read, (size_t)(data.size() - (write % dsize)));
-        SFXC_ASSERT(data_to_read > 0);
-        size_t nbytes = breader_->get_bytes(data_to_read, (char *)&data[write % dsize]);
-        SFXC_ASSERT(nbytes > 0);
-        data_read += nbytes;
-        write += nbytes;
-      }
+      // The buffer is mapped twice, so the free space is contiguous
+      size_t nbytes = breader_->get_bytes(to_read, (char *)&data[write & mask]);
+      SFXC_ASSERT(nbytes == to_read);
+      write += to_read;
       bytes_left -= to_read;
     }
     if (bytes_left == 0) {
@@ -104,7 +100,11 @@ Correlator_node_data_reader_tasklet::do_task() {
   }
 
   SFXC_ASSERT(read <= write);
+  bool new_data = (write != input_buffer.write);
   input_buffer.write = write;
+  // Wake up the bit2float threads
+  if (new_data && (notifier != NULL))
+    notifier->notify();
 }
 
 bool
@@ -128,6 +128,12 @@ int Correlator_node_data_reader_tasklet::get_fd() {
   return reader->get_fd();
 }
 
+bool Correlator_node_data_reader_tasklet::has_buffered_data() {
+  if (reader == Data_reader_ptr())
+    return false;
+  return reader->bytes_buffered() > 0;
+}
+
 bool Correlator_node_data_reader_tasklet::active() {
   if(state!=IDLE)
     return true;
@@ -140,6 +146,11 @@ Correlator_node_data_reader_tasklet::set_parameters() {
   new_stream_available = true;
 }
 
+void
+Correlator_node_data_reader_tasklet::set_notifier(Notifier *notifier_) {
+  notifier = notifier_;
+}
+
 void Correlator_node_data_reader_tasklet::get_state(std::ostream &out) {
   out << "\t\t{\n"
       << "\t\t\"stream_nr\": " << stream_nr << ",\n"
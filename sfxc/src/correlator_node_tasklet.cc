@@ -23,6 +23,7 @@ Correlator_node_tasklet::Correlator_node_tasklet(int nr_corr_node, bool pulsar_b
     pulsar_binning(pulsar_binning_),
     phased_array(phased_array_),
     has_requested(false) {
+  bit2float_thread_.set_notifier(&bit2float_notifier);
   if (phased_array){
     correlation_core_normal = new Correlation_core_phased();
     correlation_core = correlation_core_normal;
@@ -92,7 +93,12 @@ Correlator_node_tasklet::~Correlator_node_tasklet() {
 #if PRINT_TIMER
   PROGRESS_MSG("Time bit_sample_reader:  " << bit_sample_reader_timer_.measured_time());
   PROGRESS_MSG("Time bits2float:  " << bits_to_float_timer_.measured_time());
-  PROGRESS_MSG("Time delay:       " << delay_timer_.measured_time());
+  double delay_time = 0;
+  for (size_t i = 0; i < delay_threads.size(); i++) {
+    if (delay_threads[i] != Delay_thread_ptr())
+      delay_time += delay_threads[i]->timer().measured_time();
+  }
+  PROGRESS_MSG("Time delay:       " << delay_time);
   PROGRESS_MSG("Time correlation: " << correlation_timer_.measured_time());
 #endif
 }
@@ -100,11 +106,19 @@ Correlator_node_tasklet::~Correlator_node_tasklet() {
 void Correlator_node_tasklet::start_threads() {
   threadpool_.register_thread( reader_thread_.start() );
   threadpool_.register_thread( bit2float_thread_.start() );
+  for (size_t i = 0; i < delay_threads.size(); i++) {
+    if (delay_threads[i] != Delay_thread_ptr())
+      threadpool_.register_thread( delay_threads[i]->start() );
+  }
 }
 
 void Correlator_node_tasklet::stop_threads() {
   reader_thread_.stop();
   bit2float_thread_.stop();
+  for (size_t i = 0; i < delay_threads.size(); i++) {
+    if (delay_threads[i] != Delay_thread_ptr())
+      delay_threads[i]->stop();
+  }
 
   /// We wait the termination of the threads
   threadpool_.wait_for_all_termination();
@@ -154,6 +168,7 @@ void Correlator_node_tasklet::do_execute() {
 void Correlator_node_tasklet::terminate() {
   isrunning_ = false;
   integration_slices_queue.close();
+  correlation_notifier.notify();
 }
 
 void Correlator_node_tasklet::add_delay_table(Delay_table &table, int sn1, int sn2) {
@@ -187,6 +202,8 @@ void Correlator_node_tasklet::hook_added_data_reader(size_t stream_nr, Data_read
   reader_thread_.bit_sample_readers()[stream_nr] =
        Bit_sample_reader_ptr(new Correlator_node_data_reader_tasklet());
   reader_thread_.bit_sample_readers()[stream_nr]->connect_to(stream_nr, data_reader);
+  // New data wakes up the bit2float threads
+  reader_thread_.bit_sample_readers()[stream_nr]->set_notifier(&bit2float_notifier);
 
   // connect reader to data stream worker
 
@@ -197,10 +214,30 @@ void Correlator_node_tasklet::hook_added_data_reader(size_t stream_nr, Data_read
   { // create the delay modules
     if (delay_modules.size() <= stream_nr) {
       delay_modules.resize(stream_nr+1, shared_ptr<Delay_correction>());
+      delay_threads.resize(stream_nr+1, Delay_thread_ptr());
+      delay_notifiers.resize(stream_nr+1, shared_ptr<Notifier>());
     }
+    if (delay_notifiers[stream_nr] == shared_ptr<Notifier>())
+      delay_notifiers[stream_nr] = shared_ptr<Notifier>(new Notifier());
     delay_modules[stream_nr] = Delay_correction_ptr(new Delay_correction(stream_nr));
     // Connect the delay_correction to the bits2float_converter
     delay_modules[stream_nr]->connect_to(bit2float_thread_.get_output_buffer(stream_nr));
+
+    // The delay correction runs in its own thread, it is woken up when
+    // its input is pushed or its output is popped
+    Notifier *notifier = delay_notifiers[stream_nr].get();
+    bit2float_thread_.get_output_buffer(stream_nr)->set_notifiers(notifier, NULL);
+    delay_modules[stream_nr]->get_output_buffer()->set_notifiers(&correlation_notifier,
+                                                                 notifier);
+    if (delay_threads[stream_nr] == Delay_thread_ptr()) {
+      delay_threads[stream_nr] =
+        Delay_thread_ptr(new Delay_thread(delay_modules[stream_nr], *notifier,
+                                          bit2float_notifier));
+      if (isinitialized_)
+        threadpool_.register_thread( delay_threads[stream_nr]->start() );
+    } else {
+      delay_threads[stream_nr]->set_delay_module(delay_modules[stream_nr]);
+    }
   }
 
 
@@ -230,18 +267,9 @@ int Correlator_node_tasklet::get_correlate_node_number() {
 void Correlator_node_tasklet::correlate() {
   RT_STAT( dotask_state_.begin_measure() );
   bool done_work=false; 
-  delay_timer_.resume();
-  for (size_t i=0; i<delay_modules.size(); i++) {
-    if (delay_modules[i] != Delay_correction_ptr()) {
-      if (delay_modules[i]->has_work()) {
-        RT_STAT( delaycorrection_state_.begin_measure() );
-        delay_modules[i]->do_task();
-        RT_STAT( delaycorrection_state_.end_measure(1) );
-        done_work=true;
-      }
-    }
-  }
-  delay_timer_.stop();
+  // The delay correction is done by the delay threads, read the count before
+  // checking for work, so we don't miss data that arrives in the meantime
+  unsigned int count = correlation_notifier.count();
 
   correlation_timer_.resume();
   if (correlation_core->has_work()) {
@@ -258,8 +286,7 @@ void Correlator_node_tasklet::correlate() {
   RT_STAT( dotask_state_.end_measure(1) );
 
   if (!done_work)
-    usleep(1000);
-
+    correlation_notifier.wait(count);
 }
 
 void
@@ -283,6 +310,7 @@ Correlator_node_tasklet::set_parameters(const Correlation_parameters &parameters
   if ( !isinitialized_ ) {
     ///DEBUG_MSG("START THE THREADS !");
     isinitialized_ = true;
+    bit2float_thread_.set_number_of_threads(parameters.bit2float_threads);
     start_threads();
   }
 
@@ -329,9 +357,9 @@ Correlator_node_tasklet::set_parameters(const Correlation_parameters &parameters
     correlation_core->set_parameters(parameters, akima_tables, uvw, get_correlate_node_number());
   }
 
-  for (size_t i=0; i<delay_modules.size(); i++) {
-    if (delay_modules[i] != Delay_correction_ptr()) {
-      delay_modules[i]->set_parameters(parameters, akima_tables[i]);
+  for (size_t i=0; i<delay_threads.size(); i++) {
+    if (delay_threads[i] != Delay_thread_ptr()) {
+      delay_threads[i]->set_parameters(parameters, akima_tables[i]);
     }
   }
   bit2float_thread_.set_parameters(parameters, akima_tables);
@@ -386,6 +414,50 @@ output_node_set_timeslice(int slice_nr, int stream_nr, int band, int accum,
            MPI_COMM_WORLD);
 }
 
+void Correlator_node_tasklet::Delay_thread::do_execute() {
+  while (isrunning_) {
+    unsigned int count = notifier_.count();
+    bool done_work = false;
+    {
+      RAIIMutex lock(mutex_);
+      if (delay_module_->has_work()) {
+        timer_.resume();
+        delay_module_->do_task();
+        timer_.stop();
+        done_work = true;
+      }
+    }
+    // The input element is only released at the end of do_task, which
+    // can unblock the bit2float thread
+    if (done_work)
+      input_notifier_.notify();
+    else
+      notifier_.wait(count);
+  }
+}
+
+void
+Correlator_node_tasklet::Delay_thread::set_delay_module(Delay_correction_ptr delay_module) {
+  RAIIMutex lock(mutex_);
+  delay_module_ = delay_module;
+}
+
+void Correlator_node_tasklet::Delay_thread::stop() {
+  isrunning_ = false;
+  notifier_.notify();
+}
+
+void
+Correlator_node_tasklet::Delay_thread::set_parameters(const Correlation_parameters &parameters,
+                                                      Delay_table_akima &delays) {
+  {
+    RAIIMutex lock(mutex_);
+    delay_module_->set_parameters(parameters, delays);
+  }
+  // The delay correction can start on the new slice
+  notifier_.notify();
+}
+
 void Correlator_node_tasklet::get_state(std::ostream &out) {
   out << "\t\"Correlator_node_tasklet\": {\n"
       << "\t\t\"nr_corr_node\": " << nr_corr_node << ",\n"
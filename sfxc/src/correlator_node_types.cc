@@ -0,0 +1,63 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ * $Id$
+ *
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "correlator_node_types.h"
+#include "utils.h"
+
+namespace {
+// Returns a file descriptor of an anonymous file of the given size which
+// lives in memory
+int create_ring_file(size_t size) {
+  int fd = -1;
+#ifdef SYS_memfd_create
+  fd = syscall(SYS_memfd_create, "sfxc_input_buffer", 0);
+#endif
+  if (fd < 0) {
+    // Older kernels have no memfd_create, use an unlinked file in /dev/shm
+    char name[] = "/dev/shm/sfxc_input_buffer_XXXXXX";
+    fd = mkstemp(name);
+    if (fd >= 0)
+      unlink(name);
+  }
+  if (fd < 0)
+    sfxc_abort("Could not create the memory file of the input buffer");
+  if (ftruncate(fd, size) != 0)
+    sfxc_abort("Could not resize the memory file of the input buffer");
+  return fd;
+}
+}
+
+Correlator_node_types::Channel_circular_input_buffer::
+Channel_circular_input_buffer(size_t min_size) : read(0), write(0) {
+  size = sysconf(_SC_PAGESIZE);
+  while (size < min_size)
+    size *= 2;
+  mask = size - 1;
+
+  // Reserve twice the size of the buffer and map the file in both halves
+  int fd = create_ring_file(size);
+  void *base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    sfxc_abort("Could not reserve memory for the input buffer");
+  data = (value_type *)base;
+  if ((mmap(data, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+            fd, 0) == MAP_FAILED) ||
+      (mmap(data + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+            fd, 0) == MAP_FAILED))
+    sfxc_abort("Could not map the input buffer");
+  close(fd);
+}
+
+Correlator_node_types::Channel_circular_input_buffer::
+~Channel_circular_input_buffer() {
+  munmap(data, 2 * size);
+}
@@ -0,0 +1,175 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A persistent index from time to byte offset in a recording.
+ */
+
+#include "data_index.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Number of bytes at the start of the file that identify the recording
+#define DATA_INDEX_FINGERPRINT_SIZE 4096
+
+namespace {
+struct Before_offset {
+  bool operator()(const Data_index::Checkpoint &checkpoint, uint64_t offset) const {
+    return checkpoint.offset < offset;
+  }
+};
+}
+
+Data_index::Data_index(const std::string &filename)
+  : filename_(filename), index_filename_(filename + ".sfxc-index"),
+    inode_(0), fingerprint_size_(0), fingerprint_(0), modified(false) {
+  if (!load()) {
+    checkpoints.clear();
+    fingerprint_size_ = 0;
+    if (!get_fingerprint(inode_, fingerprint_size_, fingerprint_))
+      fingerprint_size_ = 0;
+  }
+}
+
+Data_index::~Data_index() {
+  save();
+}
+
+void
+Data_index::add(const Time &time, uint64_t offset, int thread_id) {
+  std::vector<Checkpoint>::iterator it =
+    std::lower_bound(checkpoints.begin(), checkpoints.end(), offset,
+                     Before_offset());
+  if ((it != checkpoints.end()) && (it->offset == offset))
+    return;
+
+  Checkpoint checkpoint;
+  checkpoint.time = time;
+  checkpoint.offset = offset;
+  checkpoint.thread_id = thread_id;
+  checkpoints.insert(it, checkpoint);
+  modified = true;
+}
+
+bool
+Data_index::find(const Time &time, uint64_t min_offset, Checkpoint &checkpoint) const {
+  std::vector<Checkpoint>::const_iterator it =
+    std::lower_bound(checkpoints.begin(), checkpoints.end(), min_offset,
+                     Before_offset());
+  bool found = false;
+  // Stop at the first checkpoint after time, in case the time stamps in the
+  // recording are not monotonic
+  for (; (it != checkpoints.end()) && (it->time <= time); it++) {
+    checkpoint = *it;
+    found = true;
+  }
+  return found;
+}
+
+bool
+Data_index::get_fingerprint(uint64_t &inode, uint64_t &nbytes,
+                            uint64_t &checksum) const {
+  int fd = open(filename_.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  char buffer[DATA_INDEX_FINGERPRINT_SIZE];
+  bool ok = (fstat(fd, &st) == 0);
+  if (ok) {
+    inode = st.st_ino;
+    if (nbytes == 0)
+      nbytes = std::min((uint64_t)st.st_size, (uint64_t)DATA_INDEX_FINGERPRINT_SIZE);
+    ok = (nbytes <= sizeof(buffer)) &&
+         (pread(fd, buffer, nbytes, 0) == (ssize_t)nbytes);
+  }
+  close(fd);
+  if (!ok)
+    return false;
+
+  // FNV-1a
+  checksum = 14695981039346656037ULL;
+  for (uint64_t i = 0; i < nbytes; i++) {
+    checksum ^= (unsigned char)buffer[i];
+    checksum *= 1099511628211ULL;
+  }
+  return true;
+}
+
+bool
+Data_index::load() {
+  std::ifstream in(index_filename_.c_str());
+  if (!in.is_open())
+    return false;
+
+  std::string line;
+  int version = 0;
+  if (!std::getline(in, line) ||
+      (sscanf(line.c_str(), "# SFXC data index %d", &version) != 1) ||
+      (version != 1))
+    return false;
+  uint64_t inode, checksum;
+  if (!(in >> inode_ >> fingerprint_size_ >> fingerprint_) ||
+      (fingerprint_size_ == 0) ||
+      !get_fingerprint(inode, fingerprint_size_, checksum) ||
+      (inode != inode_) || (checksum != fingerprint_)) {
+    DEBUG_MSG("Ignoring " << index_filename_ << ", the recording has changed");
+    return false;
+  }
+
+  int mjd, thread_id;
+  double usec;
+  uint64_t offset;
+  while (in >> mjd >> usec >> offset >> thread_id) {
+    Checkpoint checkpoint;
+    checkpoint.time.set_time_usec(mjd, usec);
+    checkpoint.offset = offset;
+    checkpoint.thread_id = thread_id;
+    if (checkpoints.empty() || (checkpoints.back().offset < offset))
+      checkpoints.push_back(checkpoint);
+  }
+  DEBUG_MSG("Loaded " << checkpoints.size() << " checkpoints from " << index_filename_);
+  return true;
+}
+
+void
+Data_index::save() {
+  if (!modified || (fingerprint_size_ == 0))
+    return;
+  modified = false;
+
+  // Write to a temporary file first, the index can be read by another
+  // correlator process at the same time
+  std::stringstream tmp_filename;
+  tmp_filename << index_filename_ << "." << getpid();
+  std::ofstream out(tmp_filename.str().c_str());
+  if (!out.is_open()) {
+    DEBUG_MSG("Could not write " << index_filename_);
+    return;
+  }
+  out << "# SFXC data index 1\n";
+  out << inode_ << " " << fingerprint_size_ << " " << fingerprint_ << "\n";
+  out << std::fixed << std::setprecision(6);
+  for (size_t i = 0; i < checkpoints.size(); i++) {
+    const Checkpoint &checkpoint = checkpoints[i];
+    out << (int)checkpoint.time.get_mjd() << " " << checkpoint.time.get_time_usec()
+        << " " << checkpoint.offset << " " << checkpoint.thread_id << "\n";
+  }
+  out.close();
+  if (!out || (rename(tmp_filename.str().c_str(), index_filename_.c_str()) != 0)) {
+    DEBUG_MSG("Could not write " << index_filename_);
+    unlink(tmp_filename.str().c_str());
+  }
+}
@@ -14,12 +14,22 @@
 #include "data_reader_factory.h"
 #include "data_reader_file.h"
 #include "data_reader_mk5.h"
+#include "data_reader_striped.h"
+#include "data_reader_vdif_udp.h"
 
-Data_reader* Data_reader_factory::get_reader(const std::vector<std::string>& sources) {
-  if (sources[0].find("file://") == 0)
-    return new Data_reader_file(sources);
+Data_reader* Data_reader_factory::get_reader(const std::vector<std::string>& sources,
+                                             const Data_reader_parameters &params) {
+  if (sources[0].find("file://") == 0) {
+    if (params.file_io == Data_reader_parameters::FILE_IO_STRIPED)
+      return new Data_reader_striped(sources, params);
+    return new Data_reader_file(sources, params);
+  }
+  if (sources[0].find("vbs://") == 0)
+    return new Data_reader_striped(sources, params);
   if (sources[0].find("mk5://") == 0)
     return new Data_reader_mk5(sources[0]);
+  if (sources[0].find("udp://") == 0)
+    return new Data_reader_vdif_udp(sources[0]);
 
   MTHROW("No data reader to handle :" + sources[0]);
 }
@@ -11,86 +11,518 @@
 #include "utils.h"
 #include <string>
 #include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-Data_reader_file::Data_reader_file(const std::vector<std::string> &sources) :
-  Data_reader(), file_end(0) {
-  init(sources);
+// Size of the part of the file that is mapped at once, a multiple of the
+// page size
+#define FILE_MMAP_WINDOW       (64 * 1024 * 1024)
+// Size of one O_DIRECT read, a multiple of the alignment
+#define FILE_DIRECT_BUFFER     (8 * 1024 * 1024)
+#define FILE_DIRECT_ALIGN      4096
+// Amount of data the read-ahead thread loads into the page cache at once
+#define FILE_PREFETCH_CHUNK    (4 * 1024 * 1024)
+
+namespace {
+ssize_t pread_full(int fd, char *buffer, size_t nbytes, uint64_t pos) {
+  ssize_t result;
+  do {
+    result = pread(fd, buffer, nbytes, (off_t)pos);
+  } while ((result < 0) && (errno == EINTR));
+  return result;
+}
+}
+
+Data_reader_file::Data_reader_file(const std::vector<std::string> &sources,
+                                   const Data_reader_parameters &params) :
+  Data_reader() {
+  init(sources, params);
 }
 
-Data_reader_file::Data_reader_file(const std::string &source) :
-  Data_reader(), file_end(0) {
+Data_reader_file::Data_reader_file(const std::string &source,
+                                   const Data_reader_parameters &params) :
+  Data_reader() {
   std::vector<std::string> sources(1, source);
-  init(sources);
+  init(sources, params);
 }
 
 void
-Data_reader_file::init(const std::vector<std::string> &sources)
+Data_reader_file::init(const std::vector<std::string> &sources,
+                       const Data_reader_parameters &params)
 {
   for (int i = 0; i < sources.size(); i++) {
     SFXC_ASSERT(sources[i].compare(0, 7, "file://") == 0);
     filenames.push(sources[i].substr(7));
   }
-  if(!open_next_file()){
+
+  switch (params.file_io) {
+  case Data_reader_parameters::FILE_IO_DIRECT:
+    io_method = DIRECT;
+    break;
+  case Data_reader_parameters::FILE_IO_READ:
+    io_method = READ;
+    break;
+  default:
+    io_method = MMAP;
+  }
+#ifndef O_DIRECT
+  if (io_method == DIRECT)
+    io_method = READ;
+#endif
+  readahead = (size_t)std::max(params.file_readahead, 0) << 20;
+
+  file_nr = 0;
+  at_eof = false;
+  window = NULL;
+  window_offset = window_size = 0;
+  prefetch_running = prefetch_stop = waiting_for_reader = reader_waiting = false;
+  prefetch_file_nr = prefetch_pos = 0;
+  inflight = false;
+  inflight_file_nr = 0;
+  n_opening = 0;
+  sync_block.data = NULL;
+  sync_block.size = 0;
+  pthread_mutex_init(&prefetch_lock, NULL);
+  pthread_cond_init(&prefetch_cond, NULL);
+
+  // The first file is opened right away
+  Input_file file;
+  bool opened_file = false;
+  while ((!opened_file) && (filenames.size() > 0)) {
+    opened_file = open_file(filenames.front(), file);
+    filenames.pop();
+  }
+  if(!opened_file){
     sfxc_abort("Could not open any input files");
   }
+  files.push_back(file);
+  file_name = file.name;
+  fd = file.fd;
+  file_io_method = file.io_method;
+  file_size = file.size;
+  file_pos = 0;
+
+  if (io_method == DIRECT) {
+    // One buffer for reads by the reader itself, the others are filled by
+    // the read-ahead thread
+    size_t n_buffers = 1;
+    if (readahead > 0)
+      n_buffers += std::max(readahead / FILE_DIRECT_BUFFER, (size_t)2);
+    for (size_t i = 0; i < n_buffers; i++) {
+      char *buffer;
+      if (posix_memalign((void **)&buffer, FILE_DIRECT_ALIGN, FILE_DIRECT_BUFFER) != 0)
+        sfxc_abort("Could not allocate buffer for O_DIRECT reads");
+      direct_buffers.push_back(buffer);
+    }
+    sync_block.data = direct_buffers[0];
+    free_buffers.assign(direct_buffers.begin() + 1, direct_buffers.end());
+  }
+
+  if (readahead > 0) {
+    prefetch_running = true;
+    if (pthread_create(&prefetch_tid, NULL, prefetch_thread, this) != 0) {
+      std::cerr << RANK_OF_NODE << " : Warning : Could not start read-ahead thread\n";
+      prefetch_running = false;
+    }
+  }
   is_seekable_ = true;
 }
 
+bool
+Data_reader_file::open_file(const std::string &filename, Input_file &file) {
+  file.name = filename;
+  file.io_method = io_method;
+  file.fd = -1;
+#ifdef O_DIRECT
+  if (file.io_method == DIRECT) {
+    file.fd = open(filename.c_str(), O_RDONLY | O_DIRECT);
+    // Not all file systems support O_DIRECT
+    if ((file.fd < 0) && (errno == EINVAL))
+      file.io_method = MMAP;
+  }
+#endif
+  if (file.io_method != DIRECT)
+    file.fd = open(filename.c_str(), O_RDONLY);
+
+  struct stat st;
+  if ((file.fd < 0) || (fstat(file.fd, &st) != 0)) {
+    if (file.fd >= 0)
+      close(file.fd);
+    std::cerr << RANK_OF_NODE << " : Warning : Cannot open " <<  filename << "\n";
+    return false;
+  }
+  file.size = st.st_size;
+  if (file.io_method != DIRECT)
+    posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  return true;
+}
+
+void
+Data_reader_file::close_file() {
+  if (window != NULL)
+    munmap(window, window_size);
+  window = NULL;
+  window_offset = window_size = 0;
+  sync_block.size = 0;
+}
+
 bool
 Data_reader_file::open_next_file(){
-  bool opened_file = false;
-  if (file.is_open())
-    file.close();
+  close_file();
 
-  while ((!opened_file) && (filenames.size() > 0)) {
-    file.open(filenames.front().c_str(), std::ios::in | std::ios::binary);
-    if (file.is_open()) { 
-      opened_file = true;
-      file.seekg(0, std::ios::end);
-      file_end = file.tellg();
-      file.seekg(0, std::ios::beg);
-    } else {
-      file_end = 0;
-      std::cerr << RANK_OF_NODE << " : Warning : Cannot open " <<  filenames.front() << "\n";
+  if (prefetch_running) {
+    // The read-ahead thread opens the files
+    pthread_mutex_lock(&prefetch_lock);
+    if ((files.size() == 1) && ((n_opening > 0) || !filenames.empty())) {
+      pthread_cond_broadcast(&prefetch_cond);
+      stall_timer.resume();
+      while ((files.size() == 1) && ((n_opening > 0) || !filenames.empty()))
+        pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+      stall_timer.stop();
+    }
+  } else {
+    while ((files.size() == 1) && !filenames.empty()) {
+      Input_file file;
+      if (open_file(filenames.front(), file))
+        files.push_back(file);
+      filenames.pop();
     }
-    filenames.pop();
+  }
+
+  bool opened_file = (files.size() > 1);
+  if (opened_file) {
+    while (inflight && (inflight_file_nr == file_nr))
+      pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+    close(files[0].fd);
+    files.pop_front();
+    file_nr++;
+    file_name = files[0].name;
+    fd = files[0].fd;
+    file_io_method = files[0].io_method;
+    file_size = files[0].size;
+    file_pos = 0;
+  }
+
+  if (prefetch_running) {
+    pthread_cond_broadcast(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_lock);
   }
   return opened_file;
 }
 
 Data_reader_file::~Data_reader_file() {
-  file.close();
+  if (prefetch_running) {
+    pthread_mutex_lock(&prefetch_lock);
+    prefetch_stop = true;
+    pthread_cond_broadcast(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_lock);
+    pthread_join(prefetch_tid, NULL);
+    PROGRESS_MSG("Data_reader_file: waited " << stall_time()
+                 << " s for data that was not read ahead");
+  }
+
+  close_file();
+  for (size_t i = 0; i < files.size(); i++)
+    close(files[i].fd);
+  for (size_t i = 0; i < direct_buffers.size(); i++)
+    free(direct_buffers[i]);
+  pthread_cond_destroy(&prefetch_cond);
+  pthread_mutex_destroy(&prefetch_lock);
 }
 
 size_t
 Data_reader_file::do_get_bytes(size_t nbytes, char *out) {
-  // If EOF is reached through a seek, the EOF bit won't be set
-  std::streampos pos = file.tellg();
-  if (!file.good() || pos >= file_end) {
-    if (!open_next_file())
-      return -1;
+  while (file_pos >= file_size) {
+    if (!open_next_file()) {
+      at_eof = true;
+      return 0;
+    }
+  }
+
+  size_t nbytes_to_read = std::min((uint64_t)nbytes, file_size - file_pos);
+  if (out != NULL) {
+    bool ok;
+    if (file_io_method == DIRECT) {
+      ok = read_direct(file_pos, nbytes_to_read, out);
+    } else {
+      bool stall = false;
+      if (prefetch_running) {
+        pthread_mutex_lock(&prefetch_lock);
+        stall = ((prefetch_file_nr < file_nr) ||
+                 ((prefetch_file_nr == file_nr) &&
+                  (prefetch_pos < file_pos + nbytes_to_read)));
+        pthread_mutex_unlock(&prefetch_lock);
+      }
+      if (stall)
+        stall_timer.resume();
+      if (file_io_method == MMAP)
+        ok = read_mmap(file_pos, nbytes_to_read, out);
+      else
+        ok = read_plain(file_pos, nbytes_to_read, out);
+      stall_timer.stop();
+    }
+    if (!ok) {
+      at_eof = true;
+      return 0;
+    }
+  }
+
+  if (prefetch_running) {
+    pthread_mutex_lock(&prefetch_lock);
+    file_pos += nbytes_to_read;
+    // Wake up the read-ahead thread once half of its data has been used
+    if (waiting_for_reader && (bytes_ahead() <= readahead / 2))
+      pthread_cond_broadcast(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_lock);
+  } else {
+    file_pos += nbytes_to_read;
   }
 
-  if (out == NULL) {
-    std::streampos pos = file.tellg();
-    size_t nbytes_to_read = std::min((size_t)(file_end - pos), nbytes);
-    file.seekg(nbytes_to_read, std::ios::cur);
+  // Like a stream, we are at the end when a read goes past the last file
+  if ((nbytes_to_read < nbytes) && !open_next_file())
+    at_eof = true;
+
+  return nbytes_to_read;
+}
 
-    return file.tellg() - pos;
+bool
+Data_reader_file::read_mmap(uint64_t pos, size_t nbytes, char *out) {
+  while (nbytes > 0) {
+    if ((pos < window_offset) || (pos >= window_offset + window_size)) {
+      if (window != NULL)
+        munmap(window, window_size);
+      window_offset = pos - (pos % FILE_MMAP_WINDOW);
+      window_size = std::min((uint64_t)FILE_MMAP_WINDOW, file_size - window_offset);
+      window = (char *)mmap(NULL, window_size, PROT_READ, MAP_SHARED, fd,
+                            (off_t)window_offset);
+      if (window == MAP_FAILED) {
+        // E.g. a device or a file system that does not support mmap
+        window = NULL;
+        window_offset = window_size = 0;
+        file_io_method = READ;
+        return read_plain(pos, nbytes, out);
+      }
+      madvise(window, window_size, MADV_SEQUENTIAL);
+      // Let the kernel read the next window while we process this one
+      if (!prefetch_running)
+        posix_fadvise(fd, (off_t)(window_offset + window_size),
+                      FILE_MMAP_WINDOW, POSIX_FADV_WILLNEED);
+    }
+    size_t n = std::min((uint64_t)nbytes, window_offset + window_size - pos);
+    memcpy(out, window + (pos - window_offset), n);
+    pos += n;
+    out += n;
+    nbytes -= n;
   }
+  return true;
+}
+
+bool
+Data_reader_file::read_direct(uint64_t pos, size_t nbytes, char *out) {
+  while (nbytes > 0) {
+    Direct_block block;
+    if ((sync_block.size > 0) && (sync_block.file_nr == file_nr) &&
+        (sync_block.offset <= pos) && (pos < sync_block.offset + sync_block.size)) {
+      block = sync_block;
+    } else {
+      bool read_block = true;
+      if (prefetch_running) {
+        pthread_mutex_lock(&prefetch_lock);
+        for (;;) {
+          release_blocks(pos);
+          if (!direct_blocks.empty() &&
+              (direct_blocks.front().file_nr == file_nr) &&
+              (direct_blocks.front().offset <= pos)) {
+            block = direct_blocks.front();
+            read_block = false;
+            break;
+          }
+          // The read-ahead thread skips the rest of a file after a read
+          // error, the reader then reads the data itself
+          if ((prefetch_file_nr > file_nr) ||
+              ((prefetch_file_nr == file_nr) && (prefetch_pos > pos)))
+            break;
+          reader_waiting = true;
+          pthread_cond_broadcast(&prefetch_cond);
+          stall_timer.resume();
+          pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+          stall_timer.stop();
+        }
+        reader_waiting = false;
+        pthread_mutex_unlock(&prefetch_lock);
+      }
 
-  file.read(out, nbytes);
+      if (read_block) {
+        sync_block.file_nr = file_nr;
+        sync_block.offset = pos - (pos % FILE_DIRECT_ALIGN);
+        ssize_t result = pread_full(fd, sync_block.data, FILE_DIRECT_BUFFER,
+                                    sync_block.offset);
+        sync_block.size = std::max(result, (ssize_t)0);
+        if (sync_block.offset + sync_block.size <= pos) {
+          std::cerr << RANK_OF_NODE << " : Error reading file : "
+                    << ((result < 0) ? strerror(errno) : "unexpected end of file") << "\n";
+          sync_block.size = 0;
+          return false;
+        }
+        block = sync_block;
+      }
+    }
 
-  if (file.eof()) {
-    nbytes = file.gcount();
-    open_next_file();
+    size_t n = std::min((uint64_t)nbytes, block.offset + block.size - pos);
+    memcpy(out, block.data + (pos - block.offset), n);
+    pos += n;
+    out += n;
+    nbytes -= n;
   }
+  return true;
+}
+
+bool
+Data_reader_file::read_plain(uint64_t pos, size_t nbytes, char *out) {
+  while (nbytes > 0) {
+    ssize_t result = pread_full(fd, out, nbytes, pos);
+    if (result <= 0) {
+      std::cerr << RANK_OF_NODE << " : Error reading file : "
+                << ((result < 0) ? strerror(errno) : "unexpected end of file") << "\n";
+      return false;
+    }
+    pos += result;
+    out += result;
+    nbytes -= result;
+  }
+  return true;
+}
 
-  return nbytes;
+void *
+Data_reader_file::prefetch_thread(void *self) {
+  static_cast<Data_reader_file *>(self)->prefetch();
+  return NULL;
+}
+
+uint64_t
+Data_reader_file::bytes_ahead() {
+  if (prefetch_file_nr < file_nr)
+    return 0;
+  if (prefetch_file_nr == file_nr)
+    return (prefetch_pos > file_pos) ? prefetch_pos - file_pos : 0;
+  uint64_t nbytes = files[0].size - file_pos;
+  for (size_t i = 1; (i < prefetch_file_nr - file_nr) && (i < files.size()); i++)
+    nbytes += files[i].size;
+  return nbytes + prefetch_pos;
+}
+
+void
+Data_reader_file::release_blocks(uint64_t pos) {
+  bool released = false;
+  while (!direct_blocks.empty() &&
+         ((direct_blocks.front().file_nr < file_nr) ||
+          ((direct_blocks.front().file_nr == file_nr) &&
+           (direct_blocks.front().offset + direct_blocks.front().size <= pos)))) {
+    free_buffers.push_back(direct_blocks.front().data);
+    direct_blocks.pop_front();
+    released = true;
+  }
+  if (released)
+    pthread_cond_broadcast(&prefetch_cond);
+}
+
+void
+Data_reader_file::prefetch() {
+  pthread_mutex_lock(&prefetch_lock);
+  while (!prefetch_stop) {
+    // Never read data the reader has already passed
+    if ((prefetch_file_nr < file_nr) ||
+        ((prefetch_file_nr == file_nr) && (prefetch_pos < file_pos))) {
+      prefetch_file_nr = file_nr;
+      prefetch_pos = file_pos - (file_pos % FILE_DIRECT_ALIGN);
+    }
+    // The reader does not release the blocks it skips
+    release_blocks(file_pos);
+    const size_t index = prefetch_file_nr - file_nr;
+    if ((index < files.size()) && (prefetch_pos >= files[index].size)) {
+      prefetch_file_nr++;
+      prefetch_pos = 0;
+      continue;
+    }
+    // A single read can span more than the read-ahead, the data is
+    // read anyway when the reader waits for it
+    waiting_for_reader = (bytes_ahead() >= readahead) && !reader_waiting;
+    if (waiting_for_reader ||
+        ((index == files.size()) && filenames.empty()) ||
+        ((index < files.size()) && (files[index].io_method == DIRECT) &&
+         free_buffers.empty())) {
+      pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+      continue;
+    }
+
+    if (index == files.size()) {
+      // Open the next file before the reader gets there
+      std::string filename = filenames.front();
+      filenames.pop();
+      n_opening++;
+      pthread_mutex_unlock(&prefetch_lock);
+      Input_file file;
+      bool opened_file = open_file(filename, file);
+      pthread_mutex_lock(&prefetch_lock);
+      n_opening--;
+      if (opened_file)
+        files.push_back(file);
+      pthread_cond_broadcast(&prefetch_cond);
+      continue;
+    }
+
+    const Input_file file = files[index];
+    const uint64_t pos = prefetch_pos;
+    inflight = true;
+    inflight_file_nr = prefetch_file_nr;
+    if (file.io_method == DIRECT) {
+      char *data = free_buffers.back();
+      free_buffers.pop_back();
+      pthread_mutex_unlock(&prefetch_lock);
+      ssize_t result = pread_full(file.fd, data, FILE_DIRECT_BUFFER, pos);
+      pthread_mutex_lock(&prefetch_lock);
+      if (result > 0) {
+        Direct_block block;
+        block.file_nr = inflight_file_nr;
+        block.offset = pos;
+        block.size = result;
+        block.data = data;
+        direct_blocks.push_back(block);
+        prefetch_pos = pos + result;
+      } else {
+        free_buffers.push_back(data);
+        prefetch_pos = file.size;
+      }
+    } else {
+      size_t nbytes = std::min((uint64_t)FILE_PREFETCH_CHUNK, file.size - pos);
+      pthread_mutex_unlock(&prefetch_lock);
+#ifdef __linux__
+      ::readahead(file.fd, (off_t)pos, nbytes);
+#else
+      posix_fadvise(file.fd, (off_t)pos, nbytes, POSIX_FADV_WILLNEED);
+#endif
+      pthread_mutex_lock(&prefetch_lock);
+      prefetch_pos = pos + nbytes;
+    }
+    inflight = false;
+    pthread_cond_broadcast(&prefetch_cond);
+  }
+  pthread_mutex_unlock(&prefetch_lock);
 }
 
 bool Data_reader_file::eof() {
-  return file.eof() || !file.good();
+  return at_eof;
+}
+
+bool Data_reader_file::get_file_position(std::string &filename, uint64_t &offset) {
+  filename = file_name;
+  offset = file_pos;
+  return true;
 }
 
 bool Data_reader_file::can_read() {
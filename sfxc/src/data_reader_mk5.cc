@@ -129,15 +129,9 @@ Data_reader_mk5::can_read()
 size_t
 Data_reader_mk5::do_get_bytes(size_t len, char *buf)
 {
-  char space[4096];
   ssize_t nbytes;
 
-  if (buf == NULL) {
-    len = std::min(len, sizeof(space));
-    buf = space;
-  }
-
-  nbytes = ::read(fd, buf, len);
+  nbytes = receive_buffer.receive(fd, len, buf);
   if (nbytes > 0)
     return nbytes;
 
@@ -37,9 +37,9 @@ Data_reader_socket::~Data_reader_socket() {}
 
 size_t Data_reader_socket::do_get_bytes(size_t nBytes, char *out) {
   SFXC_ASSERT(m_socket > 0);
-  SFXC_ASSERT(out != NULL);
 
-  ssize_t val = read(m_socket, (void *) out, nBytes);
+  /* out == NULL discards the data */
+  ssize_t val = receive_buffer.receive(m_socket, nBytes, out);
   if ( val > 0 ) return val;
   iseof = true;
 //  std::cout << "EOF is reached"<< std::endl;
@@ -47,6 +47,9 @@ size_t Data_reader_socket::do_get_bytes(size_t nBytes, char *out) {
 }
 
 bool Data_reader_socket::eof() {
+  if (receive_buffer.bytes_buffered() > 0)
+    return false;
+
 // This is linux specific code.
 #ifdef POLLRDHUP
   pollfd fds[1];
@@ -63,6 +66,9 @@ bool Data_reader_socket::eof() {
 }
 
 bool Data_reader_socket::can_read() {
+  if (receive_buffer.bytes_buffered() > 0)
+    return true;
+
   //     int fd;           /* file descriptor */
   //     short events;     /* requested events */
   //     short revents;    /* returned events */
@@ -0,0 +1,288 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A data reader that reads the files of a recording in parallel.
+ */
+
+#include "data_reader_striped.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Size of the blocks that the threads read
+#define STRIPE_BLOCK_SIZE      (8 * 1024 * 1024)
+// Directories that hold the chunks of a vbs recording
+#define STRIPE_VBS_PATTERN     "/mnt/disk*"
+
+Data_reader_striped::Data_reader_striped(const std::vector<std::string> &sources,
+                                         const Data_reader_parameters &params)
+  : first_open_file(0), read_block(0), read_pos(0), at_eof(false),
+    next_block(0), stop(false) {
+  for (size_t i = 0; i < sources.size(); i++) {
+    if (sources[i].compare(0, 6, "vbs://") == 0) {
+      add_vbs_chunks(sources[i]);
+    } else {
+      SFXC_ASSERT(sources[i].compare(0, 7, "file://") == 0);
+      add_file(sources[i].substr(7));
+    }
+  }
+  if (files.empty())
+    sfxc_abort("Could not open any input files");
+
+  for (size_t i = 0; i < files.size(); i++) {
+    for (uint64_t offset = 0; offset < files[i].size; offset += STRIPE_BLOCK_SIZE) {
+      Block block;
+      block.file = i;
+      block.offset = offset;
+      block.size = std::min(files[i].size - offset, (uint64_t)STRIPE_BLOCK_SIZE);
+      blocks.push_back(block);
+    }
+  }
+
+  const int n_threads = std::max(params.stripe_threads, 1);
+  slots.resize(2 * n_threads);
+  buffer.resize(slots.size() * STRIPE_BLOCK_SIZE);
+  for (size_t i = 0; i < slots.size(); i++) {
+    slots[i].state = FREE;
+    slots[i].block = 0;
+    slots[i].size = 0;
+    slots[i].data = &buffer[i * STRIPE_BLOCK_SIZE];
+  }
+
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&cond, NULL);
+  for (int i = 0; i < n_threads; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, read_thread, this) == 0)
+      threads.push_back(thread);
+  }
+  if (threads.empty())
+    sfxc_abort("Could not start the read threads");
+  DEBUG_MSG("Reading " << files.size() << " files with " << threads.size() << " threads");
+  is_seekable_ = true;
+}
+
+Data_reader_striped::~Data_reader_striped() {
+  pthread_mutex_lock(&lock);
+  stop = true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+  for (size_t i = 0; i < threads.size(); i++)
+    pthread_join(threads[i], NULL);
+
+  for (size_t i = 0; i < files.size(); i++) {
+    if (files[i].fd != -1)
+      close(files[i].fd);
+  }
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&lock);
+}
+
+void
+Data_reader_striped::add_file(const std::string &filename) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) {
+    LOG_MSG("Could not open " << filename << " : " << strerror(errno));
+    return;
+  }
+  Input_file file;
+  file.name = filename;
+  file.size = st.st_size;
+  file.fd = -1;
+  files.push_back(file);
+}
+
+void
+Data_reader_striped::add_vbs_chunks(const std::string &url) {
+  // vbs://[pattern/]scan
+  std::string path = url.substr(6);
+  std::string pattern = STRIPE_VBS_PATTERN;
+  size_t scan_start = path.rfind('/');
+  if (scan_start != std::string::npos) {
+    pattern = path.substr(0, scan_start);
+    path = path.substr(scan_start + 1);
+  }
+  const std::string chunks = pattern + "/" + path + "/" + path + ".*";
+
+  glob_t result;
+  if (glob(chunks.c_str(), 0, NULL, &result) != 0) {
+    LOG_MSG("No chunks found for " << url);
+    return;
+  }
+  // The chunks are numbered from 0 and are spread over the disks
+  std::vector<std::pair<uint64_t, std::string> > sequence;
+  for (size_t i = 0; i < result.gl_pathc; i++) {
+    const char *name = result.gl_pathv[i];
+    const char *number = strrchr(name, '.') + 1;
+    if ((*number == '\0') || (strspn(number, "0123456789") != strlen(number)))
+      continue;
+    sequence.push_back(std::make_pair(strtoull(number, NULL, 10), std::string(name)));
+  }
+  globfree(&result);
+
+  std::sort(sequence.begin(), sequence.end());
+  for (size_t i = 0; i < sequence.size(); i++) {
+    if ((i > 0) && (sequence[i].first == sequence[i - 1].first)) {
+      LOG_MSG("Warning: chunk " << sequence[i].first << " of " << url
+              << " is on more than one disk, using " << sequence[i - 1].second);
+      continue;
+    }
+    add_file(sequence[i].second);
+  }
+}
+
+bool
+Data_reader_striped::eof() {
+  return at_eof || (read_block >= blocks.size());
+}
+
+bool
+Data_reader_striped::can_read() {
+  pthread_mutex_lock(&lock);
+  const Slot &slot = slots[read_block % slots.size()];
+  bool result = (read_block >= blocks.size()) ||
+                ((slot.state == READY) && (slot.block == read_block));
+  pthread_mutex_unlock(&lock);
+  return result;
+}
+
+void *
+Data_reader_striped::read_thread(void *self) {
+  static_cast<Data_reader_striped *>(self)->read_blocks();
+  return NULL;
+}
+
+int
+Data_reader_striped::get_fd(size_t file) {
+  if (files[file].fd == -1) {
+    files[file].fd = open(files[file].name.c_str(), O_RDONLY);
+    if (files[file].fd == -1) {
+      LOG_MSG("Could not open " << files[file].name << " : " << strerror(errno));
+    } else {
+#ifdef POSIX_FADV_SEQUENTIAL
+      posix_fadvise(files[file].fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+  }
+  return files[file].fd;
+}
+
+void
+Data_reader_striped::close_files() {
+  const size_t current_file =
+    (read_block < blocks.size()) ? blocks[read_block].file : files.size();
+  for (; first_open_file < current_file; first_open_file++) {
+    // A thread may still be reading a block that the reader skipped
+    for (size_t i = 0; i < slots.size(); i++) {
+      if ((slots[i].state == READING) &&
+          (blocks[slots[i].block].file == first_open_file))
+        return;
+    }
+    if (files[first_open_file].fd != -1) {
+      close(files[first_open_file].fd);
+      files[first_open_file].fd = -1;
+    }
+  }
+}
+
+void
+Data_reader_striped::read_blocks() {
+  pthread_mutex_lock(&lock);
+  while (!stop) {
+    // Only read blocks that fit in the ring before the read position
+    next_block = std::max(next_block, read_block);
+    if ((next_block >= blocks.size()) ||
+        (next_block >= read_block + slots.size()) ||
+        (slots[next_block % slots.size()].state != FREE)) {
+      pthread_cond_wait(&cond, &lock);
+      continue;
+    }
+
+    const uint64_t block_nr = next_block++;
+    Slot &slot = slots[block_nr % slots.size()];
+    slot.state = READING;
+    slot.block = block_nr;
+    const Block block = blocks[block_nr];
+    const int fd = get_fd(block.file);
+    pthread_mutex_unlock(&lock);
+
+    size_t nread = 0;
+    while ((fd != -1) && (nread < block.size)) {
+      ssize_t result = pread(fd, slot.data + nread, block.size - nread,
+                             (off_t)(block.offset + nread));
+      if ((result < 0) && (errno == EINTR))
+        continue;
+      if (result <= 0) {
+        LOG_MSG("Could not read " << files[block.file].name << " : "
+                << (result < 0 ? strerror(errno) : "unexpected end of file"));
+        break;
+      }
+      nread += result;
+    }
+
+    pthread_mutex_lock(&lock);
+    slot.size = nread;
+    // The reader may have skipped the block in the meantime
+    slot.state = (block_nr < read_block) ? FREE : READY;
+    pthread_cond_broadcast(&cond);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+size_t
+Data_reader_striped::do_get_bytes(size_t nbytes, char *out) {
+  size_t done = 0;
+  pthread_mutex_lock(&lock);
+  while ((done < nbytes) && !at_eof && (read_block < blocks.size())) {
+    if ((out == NULL) && (read_pos == 0) && (nbytes - done >= blocks[read_block].size)) {
+      // Skip a whole block without waiting for it
+      Slot &slot = slots[read_block % slots.size()];
+      if ((slot.state == READY) && (slot.block == read_block))
+        slot.state = FREE;
+      done += blocks[read_block].size;
+      read_block++;
+      continue;
+    }
+
+    Slot &slot = slots[read_block % slots.size()];
+    if ((slot.state != READY) || (slot.block != read_block)) {
+      pthread_cond_broadcast(&cond);
+      pthread_cond_wait(&cond, &lock);
+      continue;
+    }
+
+    const size_t n = std::min(nbytes - done, slot.size - std::min(read_pos, slot.size));
+    if (n > 0) {
+      // The threads don't touch a slot that is ready
+      pthread_mutex_unlock(&lock);
+      if (out != NULL)
+        memcpy(out + done, slot.data + read_pos, n);
+      pthread_mutex_lock(&lock);
+    }
+    done += n;
+    read_pos += n;
+    if (read_pos >= slot.size) {
+      // A block that was read only partly ends the data
+      if (slot.size < blocks[read_block].size)
+        at_eof = true;
+      slot.state = FREE;
+      read_block++;
+      read_pos = 0;
+    }
+  }
+  close_files();
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+  return done;
+}
@@ -0,0 +1,592 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A data reader for VDIF frames sent over UDP.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+#include "data_reader_vdif_udp.h"
+#include "utils.h"
+
+// Number of frames that can be buffered
+#define VDIF_UDP_NSLOTS           8192
+// Maximum number of packets received with one system call
+#define VDIF_UDP_BATCH            64
+// Default size of the reorder buffer of a VDIF thread in frames
+#define VDIF_UDP_REORDER_WINDOW   1024
+// Larger gaps in a VDIF thread are left to the input reader
+#define VDIF_UDP_MAX_FILL         1024
+// Socket receive buffer
+#define VDIF_UDP_SOCKET_BUFFER    (64 * 1024 * 1024)
+// Time after which the reorder buffer is flushed if no packets arrive
+#define VDIF_UDP_TIMEOUT_MS       100
+// Interval between two reports of lost packets
+#define VDIF_UDP_LOG_INTERVAL     10
+
+namespace {
+inline uint32_t get_word(const char *header, int i) {
+  uint32_t word;
+  memcpy(&word, header + 4 * i, sizeof(word));
+  return word;
+}
+
+inline void set_word(char *header, int i, uint32_t word) {
+  memcpy(header + 4 * i, &word, sizeof(word));
+}
+
+// Fields of the VDIF header
+inline uint32_t vdif_seconds(const char *header) {
+  return get_word(header, 0) & 0x3fffffff;
+}
+inline uint32_t vdif_frame_nr(const char *header) {
+  return get_word(header, 1) & 0xffffff;
+}
+inline uint32_t vdif_frame_length(const char *header) {
+  return 8 * (get_word(header, 2) & 0xffffff);
+}
+inline bool vdif_legacy(const char *header) {
+  return (get_word(header, 0) >> 30) & 1;
+}
+inline int vdif_thread_id(const char *header) {
+  return (get_word(header, 3) >> 16) & 0x3ff;
+}
+/// Orders the frames of a VDIF thread in time
+inline uint64_t vdif_time(const char *header) {
+  return ((uint64_t)vdif_seconds(header) << 24) | vdif_frame_nr(header);
+}
+
+inline int64_t time_ms() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+std::vector<std::string> split(const std::string &str, char separator) {
+  std::vector<std::string> result;
+  size_t start = 0;
+  for (;;) {
+    size_t end = str.find(separator, start);
+    result.push_back(str.substr(start, end - start));
+    if (end == std::string::npos)
+      return result;
+    start = end + 1;
+  }
+}
+}
+
+
+Data_reader_vdif_udp::Data_reader_vdif_udp(const std::string &url_)
+  : url(url_), at_eof(true), use_psn(false), psn_size(0),
+    reorder_window(VDIF_UDP_REORDER_WINDOW), frame_length(0),
+    header_length(0), slot_size(0), n_reorder(0), last_receive(0),
+    frames_per_second(0), second_boundary_seen(false), lost(0),
+    have_current_frame(false), current_pos(0), stop(false) {
+  memset(&logged_counters, 0, sizeof(logged_counters));
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&cond, NULL);
+
+  // Parse URL: udp://[address]:port[,port...][?option&option...]
+  size_t host_start = url.find("://");
+  if (host_start == std::string::npos)
+    return;
+  host_start += 3;
+  size_t options_start = url.find("?", host_start);
+  std::string host = url.substr(host_start, options_start - host_start);
+  int sockets_per_port = 1;
+  std::vector<int> cpus;
+  if (options_start != std::string::npos) {
+    std::vector<std::string> options = split(url.substr(options_start + 1), '&');
+    for (size_t i = 0; i < options.size(); i++) {
+      const std::string &option = options[i];
+      if (option == "psn") {
+        use_psn = true;
+      } else if (option.compare(0, 7, "window=") == 0) {
+        reorder_window = std::max(1, atoi(option.c_str() + 7));
+      } else if (option.compare(0, 8, "sockets=") == 0) {
+        sockets_per_port = std::max(1, atoi(option.c_str() + 8));
+      } else if (option.compare(0, 5, "cpus=") == 0) {
+        std::vector<std::string> cpu_list = split(option.substr(5), ',');
+        for (size_t j = 0; j < cpu_list.size(); j++)
+          cpus.push_back(atoi(cpu_list[j].c_str()));
+      } else {
+        LOG_MSG("Warning: unknown option '" << option << "' in " << url);
+      }
+    }
+  }
+  psn_size = use_psn ? sizeof(uint64_t) : 0;
+
+  size_t port_start = host.rfind(":");
+  if (port_start == std::string::npos) {
+    LOG_MSG("No port given in " << url);
+    return;
+  }
+  std::vector<std::string> ports = split(host.substr(port_start + 1), ',');
+  for (size_t i = 0; i < ports.size(); i++) {
+    for (int j = 0; j < sockets_per_port; j++) {
+      Receiver receiver;
+      receiver.reader = this;
+      receiver.address = host.substr(0, port_start);
+      receiver.port = ports[i];
+      receiver.fd = -1;
+      receiver.cpu = cpus.empty() ? -1 : cpus[receivers.size() % cpus.size()];
+      receiver.running = false;
+      memset(&receiver.counters, 0, sizeof(receiver.counters));
+      receivers.push_back(receiver);
+      if (!open_socket(receivers.back()))
+        return;
+    }
+  }
+
+  // The receivers are not moved after the threads have started
+  at_eof = false;
+  for (size_t i = 0; i < receivers.size(); i++) {
+    Receiver &receiver = receivers[i];
+    receiver.running =
+      (pthread_create(&receiver.thread, NULL, receive_thread, &receiver) == 0);
+    if (!receiver.running) {
+      LOG_MSG("Could not start receive thread for " << url);
+      at_eof = true;
+    }
+  }
+}
+
+Data_reader_vdif_udp::~Data_reader_vdif_udp() {
+  pthread_mutex_lock(&lock);
+  stop = true;
+  pthread_mutex_unlock(&lock);
+  bool running = false;
+  for (size_t i = 0; i < receivers.size(); i++) {
+    if (receivers[i].running) {
+      pthread_join(receivers[i].thread, NULL);
+      running = true;
+    }
+  }
+  if (running)
+    log_counters();
+  for (size_t i = 0; i < receivers.size(); i++) {
+    if (receivers[i].fd != -1)
+      ::close(receivers[i].fd);
+  }
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&lock);
+}
+
+bool
+Data_reader_vdif_udp::open_socket(Receiver &receiver) {
+  struct addrinfo hints, *res0;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = PF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_PASSIVE;
+  if (::getaddrinfo(receiver.address.empty() ? NULL : receiver.address.c_str(),
+                    receiver.port.c_str(), &hints, &res0) || (res0 == NULL)) {
+    LOG_MSG("Could not resolve " << url);
+    return false;
+  }
+
+  int fd = ::socket(res0->ai_family, res0->ai_socktype, res0->ai_protocol);
+  if (fd != -1) {
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#ifdef SO_REUSEPORT
+    // Lets the kernel spread the packets over several sockets
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+    // A large socket buffer absorbs bursts while the reorder buffer is full
+    int size = VDIF_UDP_SOCKET_BUFFER;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    if (::bind(fd, res0->ai_addr, res0->ai_addrlen) == -1) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  ::freeaddrinfo(res0);
+  if (fd == -1) {
+    LOG_MSG("Could not open port " << receiver.port << " of " << url
+            << " : " << strerror(errno));
+    return false;
+  }
+  receiver.fd = fd;
+  return true;
+}
+
+bool
+Data_reader_vdif_udp::eof() {
+  return at_eof;
+}
+
+bool
+Data_reader_vdif_udp::can_read() {
+  pthread_mutex_lock(&lock);
+  bool result = have_current_frame || !output_frames.empty();
+  pthread_mutex_unlock(&lock);
+  return result;
+}
+
+Data_reader_vdif_udp::Counters
+Data_reader_vdif_udp::get_counters() {
+  Counters result;
+  memset(&result, 0, sizeof(result));
+  pthread_mutex_lock(&lock);
+  for (size_t i = 0; i < receivers.size(); i++) {
+    const Counters &counters = receivers[i].counters;
+    result.received += counters.received;
+    result.late += counters.late;
+    result.duplicated += counters.duplicated;
+    result.dropped += counters.dropped;
+    result.bad_size += counters.bad_size;
+  }
+  result.lost = lost;
+  pthread_mutex_unlock(&lock);
+  return result;
+}
+
+Data_reader_vdif_udp::Counters
+Data_reader_vdif_udp::get_counters(size_t socket) {
+  SFXC_ASSERT(socket < receivers.size());
+  pthread_mutex_lock(&lock);
+  Counters result = receivers[socket].counters;
+  pthread_mutex_unlock(&lock);
+  return result;
+}
+
+void
+Data_reader_vdif_udp::log_counters() {
+  Counters c = get_counters();
+  LOG_MSG(url << " : received " << c.received << " frames, lost " << c.lost
+          << ", late " << c.late << ", duplicated " << c.duplicated
+          << ", dropped " << c.dropped << ", wrong size " << c.bad_size);
+  if (receivers.size() > 1) {
+    for (size_t i = 0; i < receivers.size(); i++) {
+      Counters s = get_counters(i);
+      LOG_MSG("  socket " << i << " (port " << receivers[i].port << ") : received "
+              << s.received << ", late " << s.late << ", duplicated " << s.duplicated
+              << ", dropped " << s.dropped << ", wrong size " << s.bad_size);
+    }
+  }
+  logged_counters = c;
+}
+
+void *
+Data_reader_vdif_udp::receive_thread(void *receiver) {
+  Receiver *self = static_cast<Receiver *>(receiver);
+  self->reader->receive(*self);
+  return NULL;
+}
+
+bool
+Data_reader_vdif_udp::set_frame_length(const char *packet, size_t size) {
+  if (size < psn_size + 16)
+    return false;
+  const char *header = packet + psn_size;
+  const size_t length = vdif_frame_length(header);
+  if ((length < 32) || (psn_size + length != size))
+    return false;
+
+  frame_length = length;
+  header_length = vdif_legacy(header) ? 16 : 32;
+  slot_size = psn_size + frame_length;
+  slots.resize(VDIF_UDP_NSLOTS * slot_size);
+  for (int i = VDIF_UDP_NSLOTS - 1; i >= 0; i--)
+    free_slots.push_back(i);
+  LOG_MSG(url << " : receiving VDIF frames of " << frame_length << " bytes");
+  return true;
+}
+
+void
+Data_reader_vdif_udp::receive(Receiver &receiver) {
+#ifdef __linux__
+  if (receiver.cpu >= 0) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(receiver.cpu, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0)
+      LOG_MSG("Could not pin the receive thread of " << url << " to cpu " << receiver.cpu);
+  }
+#endif
+
+  std::vector<char> packet(65536);
+  struct pollfd pfd;
+  pfd.fd = receiver.fd;
+  pfd.events = POLLIN;
+  time_t last_log = ::time(NULL);
+  struct mmsghdr msgs[VDIF_UDP_BATCH];
+  struct iovec iovecs[VDIF_UDP_BATCH];
+  int batch[VDIF_UDP_BATCH];
+  for (;;) {
+    int ready = ::poll(&pfd, 1, VDIF_UDP_TIMEOUT_MS);
+
+    pthread_mutex_lock(&lock);
+    if (stop) {
+      pthread_mutex_unlock(&lock);
+      break;
+    }
+    if (ready <= 0) {
+      // Nothing arrives on any of the sockets, pass on what we have
+      if (time_ms() - last_receive >= VDIF_UDP_TIMEOUT_MS) {
+        release_frames(true);
+        pthread_cond_broadcast(&cond);
+      }
+      pthread_mutex_unlock(&lock);
+      continue;
+    }
+    int nslots = std::min((int)free_slots.size(), VDIF_UDP_BATCH);
+    for (int i = 0; i < nslots; i++) {
+      batch[i] = free_slots.back();
+      free_slots.pop_back();
+    }
+    bool have_frame_length = (frame_length != 0);
+    pthread_mutex_unlock(&lock);
+
+    if (nslots == 0) {
+      ssize_t n = ::recv(receiver.fd, &packet[0], packet.size(), MSG_DONTWAIT);
+      if (n >= 0) {
+        pthread_mutex_lock(&lock);
+        // The first frame sets the size of all frames
+        if (!have_frame_length && (frame_length == 0) &&
+            !set_frame_length(&packet[0], n)) {
+          receiver.counters.bad_size++;
+        } else if (!have_frame_length && (n == (ssize_t)slot_size) &&
+                   !free_slots.empty()) {
+          const int slot = free_slots.back();
+          free_slots.pop_back();
+          memcpy(&slots[slot * slot_size], &packet[0], slot_size);
+          add_frame(receiver, slot);
+        } else if (have_frame_length) {
+          // The reader doesn't keep up, drop the packet
+          receiver.counters.dropped++;
+        } else {
+          receiver.counters.bad_size++;
+        }
+        pthread_mutex_unlock(&lock);
+      }
+      continue;
+    }
+
+    for (int i = 0; i < nslots; i++) {
+      iovecs[i].iov_base = &slots[batch[i] * slot_size];
+      iovecs[i].iov_len = slot_size;
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_iov = &iovecs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int nreceived = ::recvmmsg(receiver.fd, msgs, nslots, MSG_DONTWAIT, NULL);
+
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < std::max(nreceived, 0); i++) {
+      if ((msgs[i].msg_len != slot_size) || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+        receiver.counters.bad_size++;
+        free_slots.push_back(batch[i]);
+      } else {
+        add_frame(receiver, batch[i]);
+      }
+    }
+    for (int i = std::max(nreceived, 0); i < nslots; i++)
+      free_slots.push_back(batch[i]);
+    release_frames(false);
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+
+    // The first receiver reports for all sockets
+    time_t now = ::time(NULL);
+    if ((&receiver == &receivers[0]) && (now - last_log >= VDIF_UDP_LOG_INTERVAL)) {
+      last_log = now;
+      Counters c = get_counters();
+      if ((c.lost != logged_counters.lost) || (c.late != logged_counters.late) ||
+          (c.dropped != logged_counters.dropped) ||
+          (c.duplicated != logged_counters.duplicated) ||
+          (c.bad_size != logged_counters.bad_size))
+        log_counters();
+    }
+  }
+}
+
+void
+Data_reader_vdif_udp::add_frame(Receiver &receiver, int slot) {
+  const char *data = &slots[slot * slot_size];
+  const char *header = data + psn_size;
+  uint64_t key;
+  if (use_psn)
+    memcpy(&key, data, sizeof(key));
+  else
+    key = vdif_time(header);
+  last_receive = time_ms();
+
+  std::map<int, Thread_stream>::iterator it = streams.find(vdif_thread_id(header));
+  if (it == streams.end()) {
+    it = streams.insert(std::make_pair(vdif_thread_id(header), Thread_stream())).first;
+    it->second.frames_released = false;
+    it->second.last_key = 0;
+  }
+  Thread_stream &stream = it->second;
+  if (stream.frames_released && (key <= stream.last_key)) {
+    receiver.counters.late++;
+    free_slots.push_back(slot);
+  } else if (!stream.reorder_buffer.insert(std::make_pair(key, slot)).second) {
+    receiver.counters.duplicated++;
+    free_slots.push_back(slot);
+  } else {
+    receiver.counters.received++;
+    n_reorder++;
+  }
+}
+
+void
+Data_reader_vdif_udp::release_frames(bool flush) {
+  for (;;) {
+    // Merge the VDIF threads by passing on the oldest frame, as soon as one
+    // of the reorder buffers is full. Keep some free slots for the receive
+    // threads.
+    bool full = flush || (n_reorder > VDIF_UDP_NSLOTS / 2);
+    Thread_stream *oldest = NULL;
+    uint64_t oldest_time = 0;
+    for (std::map<int, Thread_stream>::iterator it = streams.begin();
+         it != streams.end(); it++) {
+      Thread_stream &stream = it->second;
+      if (stream.reorder_buffer.empty())
+        continue;
+      full = full || (stream.reorder_buffer.size() > reorder_window);
+      const int slot = stream.reorder_buffer.begin()->second;
+      const uint64_t time = vdif_time(&slots[slot * slot_size + psn_size]);
+      if ((oldest == NULL) || (time < oldest_time)) {
+        oldest = &stream;
+        oldest_time = time;
+      }
+    }
+    if ((oldest == NULL) || !full)
+      return;
+
+    std::map<uint64_t, int>::iterator first = oldest->reorder_buffer.begin();
+    release_frame(first->second);
+    oldest->last_key = first->first;
+    oldest->reorder_buffer.erase(first);
+    n_reorder--;
+  }
+}
+
+void
+Data_reader_vdif_udp::release_frame(int slot) {
+  const char *header = &slots[slot * slot_size + psn_size];
+  const uint32_t seconds = vdif_seconds(header);
+  const uint32_t frame_nr = vdif_frame_nr(header);
+  frames_per_second = std::max(frames_per_second, frame_nr + 1);
+
+  Thread_stream &stream = streams[vdif_thread_id(header)];
+  if (stream.frames_released) {
+    int64_t nlost = 0;
+    if (seconds == stream.seconds) {
+      nlost = (int64_t)frame_nr - stream.frame_nr - 1;
+    } else if (seconds > stream.seconds) {
+      // The number of frames per second is only known after the first
+      // complete second
+      if (second_boundary_seen)
+        nlost = (int64_t)(seconds - stream.seconds) * frames_per_second +
+                frame_nr - stream.frame_nr - 1;
+      second_boundary_seen = true;
+    }
+    if (nlost > 0) {
+      lost += nlost;
+      // Fill small gaps with invalid frames, the input reader handles
+      // larger gaps
+      for (int64_t i = 1; (i <= nlost) && (nlost <= VDIF_UDP_MAX_FILL); i++) {
+        Output_frame lost_frame;
+        lost_frame.slot = -1;
+        memcpy(lost_frame.header, stream.header, header_length);
+        const uint64_t nr = stream.frame_nr + i;
+        set_word(lost_frame.header, 0, (get_word(stream.header, 0) & 0x40000000) | 0x80000000 |
+                 ((stream.seconds + nr / frames_per_second) & 0x3fffffff));
+        set_word(lost_frame.header, 1, (get_word(stream.header, 1) & 0xff000000) |
+                 (nr % frames_per_second));
+        output_frames.push_back(lost_frame);
+      }
+    }
+  }
+  memcpy(stream.header, header, header_length);
+  stream.seconds = seconds;
+  stream.frame_nr = frame_nr;
+  stream.frames_released = true;
+
+  Output_frame frame;
+  frame.slot = slot;
+  output_frames.push_back(frame);
+}
+
+size_t
+Data_reader_vdif_udp::do_get_bytes(size_t nbytes, char *out) {
+  size_t nread = 0;
+  int slot_to_free = -1;
+  while (nread < nbytes) {
+    if (!have_current_frame) {
+      pthread_mutex_lock(&lock);
+      if (slot_to_free >= 0)
+        free_slots.push_back(slot_to_free);
+      slot_to_free = -1;
+      if (output_frames.empty() && (nread == 0)) {
+        struct timeval now;
+        struct timespec timeout;
+        gettimeofday(&now, NULL);
+        timeout.tv_sec = now.tv_sec;
+        timeout.tv_nsec = (now.tv_usec + VDIF_UDP_TIMEOUT_MS * 1000) * 1000;
+        if (timeout.tv_nsec >= 1000000000) {
+          timeout.tv_sec++;
+          timeout.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&cond, &lock, &timeout);
+      }
+      if (output_frames.empty()) {
+        pthread_mutex_unlock(&lock);
+        break;
+      }
+      current_frame = output_frames.front();
+      output_frames.pop_front();
+      have_current_frame = true;
+      current_pos = 0;
+      pthread_mutex_unlock(&lock);
+    }
+
+    const size_t n = std::min(nbytes - nread, frame_length - current_pos);
+    if (out != NULL) {
+      if (current_frame.slot >= 0) {
+        memcpy(out + nread, &slots[current_frame.slot * slot_size + psn_size + current_pos], n);
+      } else {
+        // Header followed by zeros
+        size_t header_bytes = 0;
+        if (current_pos < header_length) {
+          header_bytes = std::min(n, header_length - current_pos);
+          memcpy(out + nread, current_frame.header + current_pos, header_bytes);
+        }
+        memset(out + nread + header_bytes, 0, n - header_bytes);
+      }
+    }
+    nread += n;
+    current_pos += n;
+    if (current_pos == frame_length) {
+      slot_to_free = current_frame.slot;
+      have_current_frame = false;
+    }
+  }
+  if (slot_to_free >= 0) {
+    pthread_mutex_lock(&lock);
+    free_slots.push_back(slot_to_free);
+    pthread_mutex_unlock(&lock);
+  }
+  return nread;
+}
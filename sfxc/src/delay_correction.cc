@@ -2,6 +2,10 @@
 #include "sfxc_math.h"
 #include "config.h"
 
+// The delay correction is done in a single fft if the fringe phase changes
+// less than this fraction of a turn during one correlation fft
+#define SINGLE_FFT_MAX_FRINGE_DRIFT 0.05
+
 Delay_correction::Delay_correction(int stream_nr_)
     : output_buffer(Output_buffer_ptr(new Output_buffer())),
       output_memory_pool(32),current_time(-1),
@@ -41,59 +45,112 @@ void Delay_correction::do_task() {
     cur_output->data.resize(nfft_cor * output_stride);
 #ifndef DUMMY_CORRELATION
   size_t tbuf_size = time_buffer.size();
-  for(int buf=0;buf<nbuffer;buf++) {
-    double delay = get_delay(current_time + fft_length/2);
-    double delay_in_samples = delay*sample_rate();
-    int integer_delay = (int)std::floor(delay_in_samples+.5);
-
-    // Output is in frequency_buffer
-    fractional_bit_shift(&input->data[buf * fft_size()],
-                         integer_delay,
-                         delay_in_samples - integer_delay);
-
-    // Input is from frequency_buffer
-    fringe_stopping(&time_buffer[tbuf_end%tbuf_size]);
-    tbuf_end += fft_size();
-
-    current_time.inc_samples(fft_size());
-    total_ffts++;
+  if (single_fft) {
+    // The delay is corrected after the final fft
+    for(int buf=0;buf<nbuffer;buf++) {
+      memcpy(&time_buffer[tbuf_end%tbuf_size], &input->data[buf * fft_size()],
+             fft_size() * sizeof(FLOAT));
+      tbuf_end += fft_size();
+      current_time.inc_samples(fft_size());
+      total_ffts++;
+    }
+  } else {
+    // All blocks are transformed in one batch
+    if (frequency_buffer.size() < (size_t)nbuffer * fft_size())
+      frequency_buffer.resize(nbuffer * fft_size());
+    fft_t2f.rfft_many(&input->data[0], fft_size(),
+                      &frequency_buffer[0], fft_size(), nbuffer);
+    Time block_time = current_time;
+    for(int buf=0;buf<nbuffer;buf++) {
+      double delay = get_delay(block_time + fft_length/2);
+      double delay_in_samples = delay*sample_rate();
+      int integer_delay = (int)std::floor(delay_in_samples+.5);
+      fractional_bit_shift(&frequency_buffer[buf * fft_size()],
+                           integer_delay,
+                           delay_in_samples - integer_delay);
+      block_time.inc_samples(fft_size());
+    }
+    fft_f2t.ifft_many(&frequency_buffer[0], fft_size(),
+                      &frequency_buffer[0], fft_size(), nbuffer);
+    for(int buf=0;buf<nbuffer;buf++) {
+      fringe_stopping(&frequency_buffer[buf * fft_size()],
+                      &time_buffer[tbuf_end%tbuf_size]);
+      tbuf_end += fft_size();
+      current_time.inc_samples(fft_size());
+      total_ffts += 3;
+    }
   }
   SFXC_ASSERT(tbuf_end - tbuf_start <= tbuf_size);
 
-  size_t nsamp_per_window;
-  if (window_func == SFXC_WINDOW_NONE) 
-    nsamp_per_window = fft_rot_size() / 2;
-  else if (window_func == SFXC_WINDOW_PFB) 
-    nsamp_per_window = fft_rot_size() * SFXC_NTAPS;
-  else
-    nsamp_per_window = fft_rot_size();
+  const size_t nsamp_per_window = samples_per_window();
+  if (windowed_buffer.size() < (size_t)nfft_cor * fft_rot_size())
+    windowed_buffer.resize(nfft_cor * fft_rot_size());
+  if (window_times.size() < (size_t)nfft_cor)
+    window_times.resize(nfft_cor);
 
   for(int i=0; i<nfft_cor; i++){
     // apply window function
+    FLOAT *windowed = (window_func == SFXC_WINDOW_PFB) ?
+                      &temp_buffer[0] : &windowed_buffer[i * fft_rot_size()];
     size_t eob = tbuf_size - tbuf_start%tbuf_size; // how many samples to end of buffer
     size_t nsamp = std::min(eob, nsamp_per_window);
-    SFXC_MUL_F(&time_buffer[tbuf_start%tbuf_size], &window[0], &temp_buffer[0], nsamp);
+    SFXC_MUL_F(&time_buffer[tbuf_start%tbuf_size], &window[0], &windowed[0], nsamp);
     if(nsamp < nsamp_per_window)
-      SFXC_MUL_F(&time_buffer[0], &window[nsamp], &temp_buffer[nsamp], nsamp_per_window - nsamp);
+      SFXC_MUL_F(&time_buffer[0], &window[nsamp], &windowed[nsamp], nsamp_per_window - nsamp);
     // Flip sideband if needed
     if (correlation_parameters.sideband != correlation_parameters.station_streams[stream_idx].sideband)
-      SFXC_MUL_F(&temp_buffer[0], &flip[0], &temp_buffer[0], nsamp_per_window);
+      SFXC_MUL_F(&windowed[0], &flip[0], &windowed[0], nsamp_per_window);
     // When SFXC_WINDOW_NONE is set we zeropad
     if (window_func == SFXC_WINDOW_NONE)
-      memset(&temp_buffer[nsamp_per_window], 0, nsamp_per_window*sizeof(FLOAT));
+      memset(&windowed[nsamp_per_window], 0, nsamp_per_window*sizeof(FLOAT));
     else if (window_func == SFXC_WINDOW_PFB) {
+      FLOAT *folded = &windowed_buffer[i * fft_rot_size()];
+      memcpy(folded, &temp_buffer[0], fft_rot_size() * sizeof(FLOAT));
       for (int j=1; j<SFXC_NTAPS; j++) {
         for (int k=0; k < fft_rot_size(); k++) {
-          temp_buffer[k] += temp_buffer[k + j * fft_rot_size()];
+          folded[k] += temp_buffer[k + j * fft_rot_size()];
         }
       }
     }
 
+    // Time at the center of the window
+    window_times[i] = current_time;
+    window_times[i].inc_samples((int64_t)(tbuf_start + nsamp_per_window / 2) - (int64_t)tbuf_end);
+
     tbuf_start += fft_rot_size()/2;
     SFXC_ASSERT(tbuf_start <= tbuf_end);
-    // Do the final fft from time to frequency
-    fft_t2f_cor.rfft(&temp_buffer[0], &temp_fft_buffer[temp_fft_offset]);
-    memcpy(&cur_output->data[i * output_stride], &temp_fft_buffer[output_offset], output_stride * sizeof(std::complex<FLOAT>));
+  }
+
+  if (nfft_cor > 0) {
+    // Do the final ffts from time to frequency in one batch. If the spectra
+    // line up with the output, they are written into the output directly.
+    const int spectrum_size = fft_rot_size() / 2 + 1;
+    const bool direct = (temp_fft_offset == 0) && (output_offset == 0) &&
+                        (spectrum_size <= output_stride);
+    std::complex<FLOAT> *spectra;
+    int spectra_stride;
+    if (direct) {
+      spectra = &cur_output->data[0];
+      spectra_stride = output_stride;
+    } else {
+      spectra_stride = temp_fft_stride;
+      if (temp_fft_buffer.size() < (size_t)nfft_cor * temp_fft_stride) {
+        temp_fft_buffer.resize(nfft_cor * temp_fft_stride);
+        memset(&temp_fft_buffer[0], 0, temp_fft_buffer.size() * sizeof(temp_fft_buffer[0]));
+      }
+      spectra = &temp_fft_buffer[temp_fft_offset];
+    }
+    fft_t2f_cor.rfft_many(&windowed_buffer[0], fft_rot_size(),
+                          spectra, spectra_stride, nfft_cor);
+    for(int i=0; i<nfft_cor; i++){
+      if (single_fft)
+        delay_correct_spectrum(&spectra[i * spectra_stride], window_times[i]);
+      if (direct)
+        SFXC_ZERO_FC(&spectra[i * spectra_stride + spectrum_size], output_stride - spectrum_size);
+      else
+        memcpy(&cur_output->data[i * output_stride], &temp_fft_buffer[i * temp_fft_stride + output_offset],
+               output_stride * sizeof(std::complex<FLOAT>));
+    }
   }
 #endif // DUMMY_CORRELATION
   if(nfft_cor > 0){
@@ -101,14 +158,9 @@ void Delay_correction::do_task() {
   }
 }
 
-void Delay_correction::fractional_bit_shift(FLOAT *input,
+void Delay_correction::fractional_bit_shift(std::complex<FLOAT> *frequency_buffer,
     int integer_shift,
     double fractional_delay) {
-  // 3) execute the complex to complex FFT, from Time to Frequency domain
-  //    input: sls. output sls_freq
-  fft_t2f.rfft(&input[0], &frequency_buffer[0]);
-  total_ffts++;
-
   // Element 0 and (fft_size() / 2) are real numbers
   frequency_buffer[0] *= 0.5;
   frequency_buffer[fft_size() / 2] *= 0.5; // Nyquist frequency
@@ -124,45 +176,77 @@ void Delay_correction::fractional_bit_shift(FLOAT *input,
   const double constant_term = tmp2 -tmp1 * (bandwidth() / 2);
   const double linear_term = tmp1*dfr;
 
-  // 5b)apply phase correction in frequency range
+  // 5b)apply phase correction exp(-i*(constant_term + k*linear_term)) in frequency range
   const int size = (fft_size() / 2) + 1;
+  SFXC_ROTATE_FC(&frequency_buffer[0], size, -constant_term, -linear_term, 1.0);
+}
 
-  double phi = constant_term;
-  // in the loop we calculate sin(phi) and cos(phi) with phi=contant_term + i*linear_term
-  // This we do efficiently using a recurrence relation
-  // sin(t+delta)=sin(t)-[a*sin(t)-b*cos(t)] ; cos(t+delta)=cos(t)-[a*cos(t)+b*sin(t)]
-  // a=2*sin^2(delta/2) ; b=sin(delta)
-  double temp=sin(linear_term/2);
-  double a=2*temp*temp,b=sin(linear_term);
-  double cos_phi, sin_phi;
-#ifdef HAVE_SINCOS
-  sincos(phi, &sin_phi, &cos_phi);
-#else
-  sin_phi = sin(phi);
-  cos_phi = cos(phi);
-#endif
-  for (int i = 0; i < size; i++) {
-    // the following should be double
-    exp_array[i] = std::complex<FLOAT>(cos_phi,-sin_phi);
-    // Compute sin_phi=sin(phi); cos_phi = cos(phi);
-    temp=sin_phi-(a*sin_phi-b*cos_phi);
-    cos_phi=cos_phi-(a*cos_phi+b*sin_phi);
-    sin_phi=temp;
-  }
-  SFXC_MUL_FC_I(&exp_array[0], &frequency_buffer[0], size);
+void Delay_correction::delay_correct_spectrum(std::complex<FLOAT> *spectrum, Time tmid) {
+  // Applies the fractional delay and fringe rotation to the spectrum of
+  // the (uncorrected) samples in one window. The delay and the fringe
+  // phase are taken at the center of the window, in the same way as
+  // fractional_bit_shift() and fringe_stopping() do for each sample.
+  const int size = fft_rot_size() / 2 + 1;
+  const double delay_in_samples = get_delay(tmid) * sample_rate();
+  const int integer_delay = (int)std::floor(delay_in_samples + .5);
+  const double fractional_delay = delay_in_samples - integer_delay;
+
+  double phi = fringe_phase(tmid);
+  phi = -sideband() * 2.0 * M_PI * (phi - std::floor(phi));
+  const double shift_phase = M_PI * (integer_delay & (4*oversamp - 1)) / (2*oversamp);
+  double constant_term = -(shift_phase + M_PI * fractional_delay / (2*oversamp)) - phi;
+  const double linear_term = 2.0 * M_PI * fractional_delay / fft_rot_size();
+  // Flipping the sideband mirrors the spectrum
+  if (correlation_parameters.sideband != correlation_parameters.station_streams[stream_idx].sideband)
+    constant_term = -constant_term - linear_term * (fft_rot_size() / 2);
+
+  // The fractional_bit_shift and fringe_stopping scale the data by fft_size() / 2
+  const double amplitude = get_amplitude(tmid) * fft_size() / 2;
+  SFXC_ROTATE_FC(&spectrum[0], size, constant_term, linear_term, amplitude);
+}
+
+double Delay_correction::fringe_phase(Time time) {
+  // The fringe phase in turns, see fringe_stopping()
+  const double center_freq = channel_freq() + sideband() * (bandwidth() / 2) + LO_offset;
+  double lo_phase = start_phase + LO_offset*time.diff(correlation_parameters.stream_start);
+  return center_freq * get_delay(time) + lo_phase + get_phase(time) / (2 * M_PI);
+}
 
-  // 6a)execute the complex to complex FFT, from Frequency to Time domain
-  //    input: sls_freq. output sls
-  fft_f2t.ifft(&frequency_buffer[0], &frequency_buffer[0]);
+bool Delay_correction::use_single_fft() {
+  // The polyphase filterbank spans several ffts
+  if (correlation_parameters.window == SFXC_WINDOW_PFB)
+    return false;
+
+  // Check the drift of the fringe phase during one window at a number of
+  // points in the slice
+  const int n_points = 16;
+  const Time window_length = fft_length * ((double)samples_per_window() / fft_size());
+  const Time begin = correlation_parameters.slice_start;
+  const Time end = begin + correlation_parameters.slice_time - window_length;
+  if (end <= begin)
+    return false;
+  for (int i = 0; i <= n_points; i++) {
+    Time t = begin + (end - begin) * ((double)i / n_points);
+    double drift = fringe_phase(t + window_length) - fringe_phase(t);
+    if (std::abs(drift) > SINGLE_FFT_MAX_FRINGE_DRIFT)
+      return false;
+  }
+  return true;
+}
 
-  total_ffts++;
+size_t Delay_correction::samples_per_window() {
+  if (correlation_parameters.window == SFXC_WINDOW_NONE) 
+    return fft_rot_size() / 2;
+  else if (correlation_parameters.window == SFXC_WINDOW_PFB) 
+    return fft_rot_size() * SFXC_NTAPS;
+  return fft_rot_size();
 }
 
-void Delay_correction::fringe_stopping(FLOAT output[]) {
+void Delay_correction::fringe_stopping(const std::complex<FLOAT> *frequency_buffer, FLOAT output[]) {
   const double mult_factor_phi = -sideband() * 2.0 * M_PI;
   const double center_freq = channel_freq() + sideband() * (bandwidth() / 2) + LO_offset;
 
-  double phi, delta_phi, sin_phi, cos_phi;
+  double phi, delta_phi;
   double lo_phase = start_phase + LO_offset*current_time.diff(correlation_parameters.stream_start);
   phi = center_freq * get_delay(current_time) + lo_phase + get_phase(current_time) / (2 * M_PI);
   double floor_phi = std::floor(phi);
@@ -180,29 +264,9 @@ void Delay_correction::fringe_stopping(FLOAT output[]) {
 
   // We use a constant amplitude factor over the fft
   double amplitude = get_amplitude(current_time + fft_length/2);
-  // We perform a recursion for the (co)sines similar to what is done in the fractional bitshift
-  double temp=sin(delta_phi/2);
-  double a=2*temp*temp,b=sin(delta_phi);
-#ifdef HAVE_SINCOS
-  sincos(phi, &sin_phi, &cos_phi);
-  sin_phi *= amplitude;
-  cos_phi *= amplitude;
-#else
-  sin_phi = amplitude * sin(phi);
-  cos_phi = amplitude * cos(phi);
-#endif
-
-  for (size_t i = 0; i < fft_size(); i++) {
-    // Compute sin_phi=sin(phi); cos_phi = cos(phi);
-    // 7)subtract dopplers and put real part in Bufs for the current segment
-    output[i] =
-      frequency_buffer[i].real()*cos_phi + frequency_buffer[i].imag()*sin_phi;
-
-    // Compute sin_phi=sin(phi); cos_phi = cos(phi);
-    temp=sin_phi-(a*sin_phi-b*cos_phi);
-    cos_phi=cos_phi-(a*cos_phi+b*sin_phi);
-    sin_phi=temp;
-  }
+  // 7)subtract dopplers and put real part in Bufs for the current segment
+  //   output[i] = real(frequency_buffer[i] * exp(-i*(phi + i*delta_phi)))
+  SFXC_ROTATE_REAL_FC(&frequency_buffer[0], output, fft_size(), -phi, -delta_phi, amplitude);
 }
 
 void
@@ -237,17 +301,17 @@ Delay_correction::set_parameters(const Correlation_parameters &parameters, Delay
      sample_rate()) / correlation_parameters.sample_rate;
   time_buffer.resize(nfft_max * fft_size());
 
-  exp_array.resize(fft_size());
+  // The buffers for the batched ffts grow with the number of ffts in a block
   frequency_buffer.resize(fft_size());
   if (parameters.window == SFXC_WINDOW_PFB)
     temp_buffer.resize(fft_rot_size() * SFXC_NTAPS);
-  else
-    temp_buffer.resize(fft_rot_size());
+  windowed_buffer.resize(fft_rot_size());
 
   if (fft_cor_size() > fft_rot_size())
-    temp_fft_buffer.resize(fft_cor_size()/2 + 4);
+    temp_fft_stride = fft_cor_size()/2 + 4;
   else
-    temp_fft_buffer.resize(fft_rot_size()/2 + 4);
+    temp_fft_stride = fft_rot_size()/2 + 4;
+  temp_fft_buffer.resize(temp_fft_stride);
   memset(&temp_fft_buffer[0], 0, temp_fft_buffer.size() * sizeof(temp_fft_buffer[0]));
 
   fft_t2f.resize(fft_size());
@@ -286,6 +350,9 @@ Delay_correction::set_parameters(const Correlation_parameters &parameters, Delay
 
   extra_delay = parameters.station_streams[stream_idx].extra_delay;
 
+  single_fft = use_single_fft();
+  DEBUG_MSG("stream " << stream_nr << ": single fft delay correction = " << single_fft);
+
   current_fft = 0;
   tbuf_start = 0;
   tbuf_end = 0;
@@ -401,6 +468,7 @@ void Delay_correction::get_state(std::ostream &out) {
       << "\t\t\"current_time\": \"" << current_time.date_string(6) << "\",\n"
       << "\t\t\"n_input_buffer\": " << input_buffer->size() << ",\n"
       << "\t\t\"LO_offset\": " << LO_offset << ",\n"
+      << "\t\t\"single_fft\": " << std::boolalpha << single_fft << ",\n"
       << "\t\t\"current_fft\": "<< current_fft << ",\n"
       << "\t\t\"n_ffts_per_integration\": " << n_ffts_per_integration << "\n"
       << "\t\t}";
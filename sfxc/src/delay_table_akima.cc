@@ -28,6 +28,8 @@
 #include <iomanip>
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <cmath>
 
 #define READ_SCAN_HEADER	0
 #define SKIP_SCAN		1
@@ -39,130 +41,124 @@
 //function definitions
 //*****************************************************************************
 
-Delay_table_akima::Delay_table_akima() {
-  ref_count = new int(1);
-  mutex = new pthread_mutex_t;
-  pthread_mutex_init(mutex, NULL);
+namespace {
+// Computes the coefficients of the Akima spline through the n points (x, y),
+// using the same boundary conditions and order of operations as the akima
+// interpolation of GSL. The coefficients of interval i are written to
+// coefficients[stride * i + 0..3].
+void
+akima_coefficients(const double *x, const double *y, int n,
+                   double *coefficients, int stride) {
+  SFXC_ASSERT(n >= 3);
+  // Slopes of the segments, m[-2], m[-1], m[n-1] and m[n] are extrapolated
+  std::vector<double> slopes(n + 3);
+  double *m = &slopes[2];
+  for (int i = 0; i < n - 1; i++)
+    m[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+  m[-2] = 3.0 * m[0] - 2.0 * m[1];
+  m[-1] = 2.0 * m[0] - m[1];
+  m[n - 1] = 2.0 * m[n - 2] - m[n - 3];
+  m[n] = 3.0 * m[n - 2] - 2.0 * m[n - 3];
+
+  for (int i = 0; i < n - 1; i++) {
+    double *c = &coefficients[stride * i];
+    c[0] = y[i];
+    const double NE = fabs(m[i + 1] - m[i]) + fabs(m[i - 1] - m[i - 2]);
+    if (NE == 0.0) {
+      c[1] = m[i];
+      c[2] = 0.0;
+      c[3] = 0.0;
+    } else {
+      const double h_i = x[i + 1] - x[i];
+      const double NE_next = fabs(m[i + 2] - m[i + 1]) + fabs(m[i] - m[i - 1]);
+      const double alpha_i = fabs(m[i - 1] - m[i - 2]) / NE;
+      double tL_ip1;
+      if (NE_next == 0.0) {
+        tL_ip1 = m[i];
+      } else {
+        const double alpha_ip1 = fabs(m[i] - m[i - 1]) / NE_next;
+        tL_ip1 = (1.0 - alpha_ip1) * m[i] + alpha_ip1 * m[i + 1];
+      }
+      c[1] = (1.0 - alpha_i) * m[i - 1] + alpha_i * m[i];
+      c[2] = (3.0 * m[i] - 2.0 * c[1] - tL_ip1) / h_i;
+      c[3] = (c[1] + tL_ip1 - 2.0 * m[i]) / (h_i * h_i);
+    }
+  }
 }
 
-Delay_table_akima::~Delay_table_akima() {
-  free_reference();
+inline double
+eval(const double *c, double dx) {
+  return c[0] + dx * (c[1] + dx * (c[2] + c[3] * dx));
 }
 
-Delay_table_akima::Delay_table_akima(const Delay_table_akima &other) {
-  copy(other);
+inline double
+eval_deriv(const double *c, double dx) {
+  return c[1] + dx * (2.0 * c[2] + 3.0 * c[3] * dx);
 }
 
-void
-Delay_table_akima::free_reference() {
-  pthread_mutex_lock(mutex);
-  *ref_count -= 1;
-  if (*ref_count == 0) {
-    for (int i = 0 ; i < splineakima.size(); i++) {
-      gsl_spline_free(splineakima[i]);
-      gsl_spline_free(splineakima_ph[i]);
-      gsl_spline_free(splineakima_amp[i]);
-      gsl_interp_accel_free(acc[i]);
-      gsl_interp_accel_free(acc_ph[i]);
-      gsl_interp_accel_free(acc_amp[i]);
-    }
-    pthread_mutex_unlock(mutex);
-    pthread_mutex_destroy (mutex);
-    delete mutex;
-    delete ref_count;
-  } else {
-   pthread_mutex_unlock(mutex);
-  }
-  sources.resize(0);
-  splineakima.resize(0);
-  splineakima_ph.resize(0);
-  splineakima_amp.resize(0);
-  acc.resize(0);
-  acc_ph.resize(0);
-  acc_amp.resize(0);
+inline double
+eval_deriv2(const double *c, double dx) {
+  return 2.0 * c[2] + 6.0 * c[3] * dx;
 }
-
-void
-Delay_table_akima::copy(const Delay_table_akima &other) {
-  pthread_mutex_lock(other.mutex);
-  mutex = other.mutex;
-  ref_count = other.ref_count;
-  *ref_count += 1;
-  clock_epoch = other.clock_epoch;
-  clock_offset = other.clock_offset;
-  clock_rate = other.clock_rate;
-  splineakima = other.splineakima;
-  splineakima_ph = other.splineakima_ph;
-  splineakima_amp = other.splineakima_amp;
-  acc = other.acc;
-  acc_ph = other.acc_ph;
-  acc_amp = other.acc_amp;
-  interval_begin = other.interval_begin;
-  interval_end = other.interval_end;
-  scan_begin = other.scan_begin;
-  sources = other.sources;
-  pthread_mutex_unlock(mutex);
 }
 
-void Delay_table_akima::operator=(const Delay_table_akima &other) {
-  free_reference();
-  copy(other);
+Delay_table_akima::Delay_table_akima()
+  : clock_offset(0), clock_rate(0) {
 }
 
-//calculates the delay for the delayType at time
-//get the next line from the delay table file
-double Delay_table_akima::delay(const Time &time, int phase_center) {
+const double *
+Delay_table_akima::find_interval(const Time &time, int phase_center, double &dx) const {
   SFXC_ASSERT(time >= interval_begin);
   SFXC_ASSERT(time <= interval_end);
-  SFXC_ASSERT(splineakima.size() > 0);
+  SFXC_ASSERT(splines && (phase_center < (int)splines->size()));
 
+  const Spline &spline = (*splines)[phase_center];
+  const double *knots = &spline.knots[0];
+  const int n_intervals = spline.knots.size() - 1;
   double sec = time.diff(scan_begin);
-  //std::cerr << RANK_OF_NODE << ", t = " << time << ", interval = " << interval_begin << " - " << interval_end 
-  //          << ", scan_begin = " << scan_begin << ", sec = " << sec << "\n";
-  double result = gsl_spline_eval(splineakima[phase_center], sec, acc[phase_center]);
-  sec = time.diff(clock_epoch);
+  int i = (int)floor((sec - knots[0]) * spline.inv_step);
+  i = std::max(0, std::min(i, n_intervals - 1));
+  // Correct for rounding errors in the position of the knots
+  if ((i > 0) && (sec < knots[i]))
+    i--;
+  else if ((i < n_intervals - 1) && (sec >= knots[i + 1]))
+    i++;
+  dx = sec - knots[i];
+  return &spline.coefficients[N_COEFFICIENTS * i];
+}
+
+//calculates the delay for the delayType at time
+double Delay_table_akima::delay(const Time &time, int phase_center) {
+  double dx;
+  const double *c = find_interval(time, phase_center, dx);
+  double result = eval(c + DELAY, dx);
+  double sec = time.diff(clock_epoch);
   double clock_drift = clock_offset + sec * clock_rate;
   return result + clock_drift;
 }
 
 double Delay_table_akima::rate(const Time &time, int phase_center) {
-  SFXC_ASSERT(time >= interval_begin);
-  SFXC_ASSERT(time <= interval_end);
-  SFXC_ASSERT(splineakima.size() > 0);
-
-  double sec = time.diff(scan_begin);
-  double result = gsl_spline_eval_deriv(splineakima[phase_center], sec, acc[phase_center]);
-  return result + clock_rate;
+  double dx;
+  const double *c = find_interval(time, phase_center, dx);
+  return eval_deriv(c + DELAY, dx) + clock_rate;
 }
 
 double Delay_table_akima::accel(const Time &time, int phase_center) {
-  SFXC_ASSERT(time >= interval_begin);
-  SFXC_ASSERT(time <= interval_end);
-  SFXC_ASSERT(splineakima.size() > 0);
-
-  double sec = time.diff(scan_begin);
-  double result = gsl_spline_eval_deriv2(splineakima[phase_center], sec, acc[phase_center]);
-  return result;
+  double dx;
+  const double *c = find_interval(time, phase_center, dx);
+  return eval_deriv2(c + DELAY, dx);
 }
 
 double Delay_table_akima::phase(const Time &time, int phase_center) {
-  SFXC_ASSERT(time >= interval_begin);
-  SFXC_ASSERT(time <= interval_end);
-  SFXC_ASSERT(splineakima.size() > phase_center);
-
-  double sec = time.diff(scan_begin);
-  double result = gsl_spline_eval(splineakima_ph[phase_center], sec, acc_ph[phase_center]);
-  return result;
+  double dx;
+  const double *c = find_interval(time, phase_center, dx);
+  return eval(c + PHASE, dx);
 }
 
 double Delay_table_akima::amplitude(const Time &time, int phase_center) {
-  SFXC_ASSERT(time >= interval_begin);
-  SFXC_ASSERT(time <= interval_end);
-  SFXC_ASSERT(splineakima.size() > phase_center);
-
-  double sec = time.diff(scan_begin);
-  double result = gsl_spline_eval(splineakima_amp[phase_center], sec, acc_amp[phase_center]);
-  return result;
+  double dx;
+  const double *c = find_interval(time, phase_center, dx);
+  return eval(c + AMPLITUDE, dx);
 }
 
 // Default constructor
@@ -495,12 +491,9 @@ Delay_table::create_akima_spline(const Time start_, const Time duration) {
 
   // Create the splines
   Delay_table_akima result;
-  result.splineakima.resize(n_sources_in_current_scan);
-  result.splineakima_ph.resize(n_sources_in_current_scan);
-  result.splineakima_amp.resize(n_sources_in_current_scan);
-  result.acc.resize(n_sources_in_current_scan);
-  result.acc_ph.resize(n_sources_in_current_scan);
-  result.acc_amp.resize(n_sources_in_current_scan);
+  std::vector<Delay_table_akima::Spline> *splines =
+    new std::vector<Delay_table_akima::Spline>(n_sources_in_current_scan);
+  result.splines = shared_ptr<const std::vector<Delay_table_akima::Spline> >(splines);
   result.sources.resize(n_sources_in_current_scan);
   SFXC_ASSERT(n_sources_in_current_scan > 0);
   for (int i = 0; i < n_sources_in_current_scan; i++) {
@@ -512,17 +505,21 @@ Delay_table::create_akima_spline(const Time start_, const Time duration) {
     int idx = (int)interval_begin.diff(scan.begin - padding_time);
     SFXC_ASSERT(n_pts > 4);
 
-    // Initialise the Akima spline
-    result.acc[i] = gsl_interp_accel_alloc();
-    result.acc_ph[i] = gsl_interp_accel_alloc();
-    result.acc_amp[i] = gsl_interp_accel_alloc();
-    result.splineakima[i] = gsl_spline_alloc(gsl_interp_akima, n_pts);
-    result.splineakima_ph[i] = gsl_spline_alloc(gsl_interp_akima, n_pts);
-    result.splineakima_amp[i] = gsl_spline_alloc(gsl_interp_akima, n_pts);
-
-    gsl_spline_init(result.splineakima[i], &times[scan.times+idx], &delays[scan.delays+idx], n_pts);
-    gsl_spline_init(result.splineakima_ph[i], &times[scan.times+idx], &phases[scan.phases+idx], n_pts);
-    gsl_spline_init(result.splineakima_amp[i], &times[scan.times+idx], &amplitudes[scan.amplitudes+idx], n_pts);
+    // Compute the polynomials of the Akima splines
+    Delay_table_akima::Spline &spline = (*splines)[i];
+    const double *x = &times[scan.times + idx];
+    spline.knots.assign(x, x + n_pts);
+    spline.inv_step = (n_pts - 1) / (x[n_pts - 1] - x[0]);
+    spline.coefficients.resize((n_pts - 1) * Delay_table_akima::N_COEFFICIENTS);
+    akima_coefficients(x, &delays[scan.delays + idx], n_pts,
+                       &spline.coefficients[Delay_table_akima::DELAY],
+                       Delay_table_akima::N_COEFFICIENTS);
+    akima_coefficients(x, &phases[scan.phases + idx], n_pts,
+                       &spline.coefficients[Delay_table_akima::PHASE],
+                       Delay_table_akima::N_COEFFICIENTS);
+    akima_coefficients(x, &amplitudes[scan.amplitudes + idx], n_pts,
+                       &spline.coefficients[Delay_table_akima::AMPLITUDE],
+                       Delay_table_akima::N_COEFFICIENTS);
   }
 
   result.scan_begin = scans[scan_nr].begin;
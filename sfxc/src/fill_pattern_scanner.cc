@@ -0,0 +1,129 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A scanner for the Mark5 fill pattern in frames of data.
+ */
+
+#include "fill_pattern_scanner.h"
+#include "sfxc_simd.h"
+#include "utils.h"
+
+#include <cstring>
+
+namespace {
+typedef size_t (*Scan_function)(const unsigned char *, size_t, size_t, bool);
+
+#ifdef SFXC_X86_SIMD
+// Compare 128 bytes per iteration and leave the exact position within
+// them to the scalar loop
+__attribute__((target("avx2")))
+size_t scan_avx2(const unsigned char *data, size_t begin, size_t end, bool fill) {
+  const __m256i pattern = _mm256_set1_epi32(MARK5_FILLPATTERN);
+  size_t i = begin;
+  for (; i + 32 <= end; i += 32) {
+    const __m256i *in = (const __m256i *)(data + 4 * i);
+    const __m256i eq0 = _mm256_cmpeq_epi32(_mm256_loadu_si256(in), pattern);
+    const __m256i eq1 = _mm256_cmpeq_epi32(_mm256_loadu_si256(in + 1), pattern);
+    const __m256i eq2 = _mm256_cmpeq_epi32(_mm256_loadu_si256(in + 2), pattern);
+    const __m256i eq3 = _mm256_cmpeq_epi32(_mm256_loadu_si256(in + 3), pattern);
+    if (fill) {
+      const __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1),
+                                          _mm256_or_si256(eq2, eq3));
+      if (_mm256_movemask_epi8(any) != 0)
+        break;
+    } else {
+      const __m256i all = _mm256_and_si256(_mm256_and_si256(eq0, eq1),
+                                           _mm256_and_si256(eq2, eq3));
+      if (_mm256_movemask_epi8(all) != -1)
+        break;
+    }
+  }
+  return scan_fill_pattern_scalar(data, i, end, fill);
+}
+
+__attribute__((target("sse2")))
+size_t scan_sse2(const unsigned char *data, size_t begin, size_t end, bool fill) {
+  const __m128i pattern = _mm_set1_epi32(MARK5_FILLPATTERN);
+  size_t i = begin;
+  for (; i + 16 <= end; i += 16) {
+    const __m128i *in = (const __m128i *)(data + 4 * i);
+    const __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128(in), pattern);
+    const __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128(in + 1), pattern);
+    const __m128i eq2 = _mm_cmpeq_epi32(_mm_loadu_si128(in + 2), pattern);
+    const __m128i eq3 = _mm_cmpeq_epi32(_mm_loadu_si128(in + 3), pattern);
+    if (fill) {
+      const __m128i any = _mm_or_si128(_mm_or_si128(eq0, eq1),
+                                       _mm_or_si128(eq2, eq3));
+      if (_mm_movemask_epi8(any) != 0)
+        break;
+    } else {
+      const __m128i all = _mm_and_si128(_mm_and_si128(eq0, eq1),
+                                        _mm_and_si128(eq2, eq3));
+      if (_mm_movemask_epi8(all) != 0xffff)
+        break;
+    }
+  }
+  return scan_fill_pattern_scalar(data, i, end, fill);
+}
+#endif // SFXC_X86_SIMD
+
+const char *scanner_name = "scalar";
+
+Scan_function select_scanner() {
+#ifdef SFXC_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    scanner_name = "avx2";
+    return scan_avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    scanner_name = "sse2";
+    return scan_sse2;
+  }
+#endif
+  return scan_fill_pattern_scalar;
+}
+
+const Scan_function scanner = select_scanner();
+}
+
+size_t
+scan_fill_pattern(const unsigned char *data, size_t begin, size_t end, bool fill) {
+  return scanner(data, begin, end, fill);
+}
+
+size_t
+scan_fill_pattern_scalar(const unsigned char *data, size_t begin, size_t end,
+                         bool fill) {
+  for (size_t i = begin; i < end; i++) {
+    uint32_t word;
+    memcpy(&word, data + 4 * i, sizeof(word));
+    if ((word == MARK5_FILLPATTERN) == fill)
+      return i;
+  }
+  return end;
+}
+
+const char *
+fill_pattern_scanner_name() {
+  return scanner_name;
+}
+
+void
+flag_fill_pattern(const unsigned char *data, size_t nbytes, size_t begin,
+                  std::vector<Input_node_types::Invalid_block> &invalid) {
+  const size_t nwords = nbytes / 4;
+  size_t start = begin / 4;
+  while (start < nwords) {
+    start = scan_fill_pattern(data, start, nwords, true);
+    if (start >= nwords)
+      break;
+    const size_t end = scan_fill_pattern(data, start, nwords, false);
+    Input_node_types::add_invalid(invalid, 4 * start, 4 * (end - start));
+    start = end;
+  }
+}
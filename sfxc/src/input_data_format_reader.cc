@@ -1,72 +1,86 @@
 #include "input_data_format_reader.h"
+#include "fill_pattern_scanner.h"
+#include "data_reader_blocking.h"
 
 Input_data_format_reader::
 Input_data_format_reader(shared_ptr<Data_reader> data_reader)
-  : data_reader_(data_reader), is_open_(false), offset(0.) {
+  : data_reader_(data_reader), is_open_(false), offset(0.),
+    use_index_(false) {
 }
 
 Input_data_format_reader::~Input_data_format_reader() {
 }
 
+bool Input_data_format_reader::get_index(uint64_t &file_offset) {
+  std::string filename;
+  if (!data_reader_->get_file_position(filename, file_offset)) {
+    use_index_ = false;
+    return false;
+  }
+  if ((index_ == NULL) || (index_->filename() != filename)) {
+    // Starting with a new file, the index of the previous file is saved
+    index_ = shared_ptr<Data_index>(new Data_index(filename));
+  }
+  return true;
+}
+
+void Input_data_format_reader::add_index_checkpoint(const Time &time,
+                                                    uint64_t header_pos,
+                                                    int thread_id) {
+  // The next checkpoint is at the first header of the next second
+  const Time abs_time = time + offset;
+  next_index_time_.set_time((int)abs_time.get_mjd(), floor(abs_time.get_time()) + 1);
+  next_index_time_ -= offset;
+
+  uint64_t file_offset;
+  if (!get_index(file_offset))
+    return;
+  const uint64_t bytes_since_header = data_reader_->data_counter() - header_pos;
+  // The header was in the previous file
+  if (bytes_since_header > file_offset)
+    return;
+  index_->add(abs_time, file_offset - bytes_since_header, thread_id);
+}
+
+bool Input_data_format_reader::goto_indexed_time(Time time,
+                                                 Data_index::Checkpoint &checkpoint) {
+  uint64_t file_offset;
+  if (!use_index_ || !get_index(file_offset) ||
+      (bytes_buffered() > file_offset))
+    return false;
+  // Position of the reader in the file
+  file_offset -= bytes_buffered();
+  if (!index_->find(time + offset, file_offset + 1, checkpoint))
+    return false;
+
+  const uint64_t nbytes = checkpoint.offset - file_offset;
+  DEBUG_MSG("Skipping " << nbytes << " bytes to " << checkpoint.time - offset
+            << " using the index of " << index_->filename());
+  return (skip_bytes(nbytes) == nbytes);
+}
+
+void Input_data_format_reader::save_index() {
+  if (index_ != NULL)
+    index_->save();
+}
+
 bool Input_data_format_reader::eof() {
   return data_reader_->eof();
 }
 
-void Input_data_format_reader::find_fill_pattern(Data_frame &data){
-  int buffer_size = data.buffer->data.size() / 4; // number of 32 bit words in buffer
-  uint32_t *buffer = (uint32_t *)&data.buffer->data[0];
+size_t Input_data_format_reader::skip_bytes(size_t nbytes) {
+  return Data_reader_blocking::get_bytes_s(data_reader_.get(), nbytes, NULL);
+}
 
+void Input_data_format_reader::find_fill_pattern(Data_frame &data){
   // See if there is already a bit of invalid data (assumed to start at byte 0)
   int start = 0;
   if (data.invalid.size() > 0) {
     SFXC_ASSERT(data.invalid.size() == 1);
     SFXC_ASSERT(data.invalid[0].invalid_begin == 0);
-    start = data.invalid[0].nr_invalid / 4;
+    start = data.invalid[0].nr_invalid;
   }
 
-  while (start < buffer_size) {
-    // Find the start of the fill pattern
-    if (buffer[start] != MARK5_FILLPATTERN) {
-      int step = std::min(MARK5_FILLPATTERN_NWORDS, buffer_size - start - 1);
-      while (step > 0) {
-        if (buffer[start + step] != MARK5_FILLPATTERN) {
-          start += step;
-	  step = std::min(step, buffer_size - start - 1);
-        } else {
-          step /= 2;
-        }
-      }
-      // Make sure we point at the first word containing fill pattern
-      // (or past the end of the buffer) and not at the last word that
-      // does no contain fill pattern
-      start += 1;
-    }
-
-    // Bail if we didn't find any fill pattern
-    if (start >= buffer_size)
-      break;
-
-    // Find the end of the fill pattern
-    int end = start;
-    int step = std::min(MARK5_FILLPATTERN_NWORDS, buffer_size - end - 1);
-    while (step > 0) {
-      if (buffer[end + step] == MARK5_FILLPATTERN) {
-        end += step;
-	step = std::min(step, buffer_size - end - 1);
-      } else {
-        step /= 2;
-      }
-    }
-
-    SFXC_ASSERT(end - start + 1 > 0);
-    int old_size = data.invalid.size();
-    data.invalid.resize(old_size + 1);
-    data.invalid[old_size].invalid_begin = start * 4;
-    data.invalid[old_size].nr_invalid = (end - start + 1) * 4; // nr_invalid is in bytes
-#if 0
-    std::cout << RANK_OF_NODE << " : " << (end - start + 1) << " words of fill pattern found" << std::endl;
-#endif
-
-    start = end + 1;
-  }
+  flag_fill_pattern(&data.buffer->data[0], data.buffer->data.size(), start,
+                    data.invalid);
 }
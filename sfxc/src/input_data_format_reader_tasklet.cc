@@ -264,6 +264,7 @@ void
 Input_data_format_reader_tasklet::set_parameters(const Input_node_parameters &params){
   data_modulation = params.data_modulation;
   reader_->set_parameters(params);
+  reader_->set_use_index(params.data_index);
 
   if (reader_->get_transport_type() == VDIF && params.n_tracks == 0) {
     current_time.resize(params.channels.size());
@@ -361,9 +362,10 @@ randomize_block() {
     input_element_.buffer->data.resize(size);
   }
 #ifdef SFXC_INVALIDATE_SAMPLES
-  input_element_.invalid.resize(1);
-  input_element_.invalid[0].invalid_begin = 0;
-  input_element_.invalid[0].nr_invalid = size;
+  // Only the invalid block travels on, the channel extractor skips the
+  // data and the correlator node turns it into zero-weight samples
+  input_element_.invalid.resize(0);
+  input_element_.add_invalid(0, size);
 #ifdef SFXC_CHECK_INVALID_SAMPLES
   value_type *buffer = input_element_.buffer->data[0];
   for (size_t i=0; i<size; i++) {
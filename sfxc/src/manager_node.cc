@@ -449,7 +449,8 @@ Manager_node::initialise() {
     const std::string &station = control_parameters.station(station_map[input_node]);
     const std::string &datastream = datastream_map[input_node];
     set_data_reader(input_node + 3, 0,
-		    control_parameters.data_sources(station, datastream));
+		    control_parameters.data_sources(station, datastream),
+		    control_parameters.get_data_reader_parameters());
   }
 
   start_time = control_parameters.get_start_time();
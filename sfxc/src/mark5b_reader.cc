@@ -49,6 +49,15 @@ Mark5b_reader::goto_time(Data_frame &data, Time time) {
         break;
     }
   } else if (time > get_current_time()){
+    // Skip to the last header before time that is in the index
+    Data_index::Checkpoint checkpoint;
+    if (goto_indexed_time(time, checkpoint)) {
+      // The index can skip more than a day
+      current_jday = (int)checkpoint.time.get_mjd();
+      if (!read_new_block(data))
+        return get_current_time();
+    }
+
     // Search data with 1 second steps
     const size_t size_mk5b_block =
       (SIZE_MK5B_HEADER+SIZE_MK5B_FRAME)*SIZE_MK5B_WORD;
@@ -81,6 +90,7 @@ Mark5b_reader::goto_time(Data_frame &data, Time time) {
       if((current_header.frame_nr % N_MK5B_BLOCKS_TO_READ) != 0)
         return resync_header(data);
     }
+    save_index();
   }
   return get_current_time();
 }
@@ -114,6 +124,7 @@ bool Mark5b_reader::read_new_block(Data_frame &data) {
     buffer.resize(size_data_block());
   }
   char *mark5b_block = (char *)&buffer[0];
+  const uint64_t header_pos = data_reader_->data_counter();
   for (int i = 0 ; i < N_MK5B_BLOCKS_TO_READ ; i++) {
     if (i == 0) {
       int byte_read = Data_reader_blocking::get_bytes_s( data_reader_.get(),
@@ -154,6 +165,7 @@ bool Mark5b_reader::read_new_block(Data_frame &data) {
     old_time_ = current_time_;
   }
   data.start_time = current_time_;
+  update_index(current_time_, header_pos, 0);
   // Check if there is a fill pattern in the data and if so, mark the data invalid
   data.invalid.resize(0);
   find_fill_pattern(data);
@@ -706,7 +706,7 @@ MPI_Transfer::receive(MPI_Status &status, std::map<std::string, int> &sources){
 void
 MPI_Transfer::send(Input_node_parameters &input_node_param, int rank) {
   int size = 0;
-  size = 5 * sizeof(int32_t) + 4 * sizeof(int64_t);
+  size = 7 * sizeof(int32_t) + 4 * sizeof(int64_t);
   for (Input_node_parameters::Channel_iterator channel =
          input_node_param.channels.begin();
        channel != input_node_param.channels.end(); channel++) {
@@ -738,6 +738,11 @@ MPI_Transfer::send(Input_node_parameters &input_node_param, int rank) {
   int exit_on_empty_datastream = input_node_param.exit_on_empty_datastream ? 1 : 0;
   MPI_Pack(&exit_on_empty_datastream, 1, MPI_INT32, 
            message_buffer, size, &position, MPI_COMM_WORLD);
+  MPI_Pack(&input_node_param.channel_extractor_threads, 1, MPI_INT32,
+           message_buffer, size, &position, MPI_COMM_WORLD);
+  int data_index = input_node_param.data_index ? 1 : 0;
+  MPI_Pack(&data_index, 1, MPI_INT32,
+           message_buffer, size, &position, MPI_COMM_WORLD);
 
   length = (int32_t)input_node_param.channels.size();
   MPI_Pack(&length, 1, MPI_INT32,
@@ -811,6 +816,13 @@ MPI_Transfer::receive(MPI_Status &status, Input_node_parameters &input_node_para
   MPI_Unpack(buffer, size, &position, &exit_on_empty_datastream, 
              1, MPI_INT32, MPI_COMM_WORLD);
   input_node_param.exit_on_empty_datastream = (exit_on_empty_datastream == 1);
+  MPI_Unpack(buffer, size, &position,
+             &input_node_param.channel_extractor_threads, 1, MPI_INT32,
+             MPI_COMM_WORLD);
+  int data_index;
+  MPI_Unpack(buffer, size, &position, &data_index,
+             1, MPI_INT32, MPI_COMM_WORLD);
+  input_node_param.data_index = (data_index == 1);
   int32_t n_channels;
   MPI_Unpack(buffer, size, &position,
              &n_channels, 1, MPI_INT32,
@@ -855,7 +867,9 @@ MPI_Transfer::receive(MPI_Status &status, Input_node_parameters &input_node_para
 void
 MPI_Transfer::send(Correlation_parameters &corr_param, int rank) {
   int size = 0;
-  size = 11 * sizeof(int64_t) + 12 * sizeof(int32_t) + 14 * sizeof(char) +
+  int32_t wisdom_dir_len = corr_param.fftw_wisdom_dir.size() + 1;
+  size = 11 * sizeof(int64_t) + 15 * sizeof(int32_t) + 14 * sizeof(char) +
+    wisdom_dir_len * sizeof(char) +
     corr_param.station_streams.size() * (3 * sizeof(int64_t) + 4 * sizeof(int32_t) + 2 * sizeof(char) + 2 * sizeof(double));
   int position = 0;
   char message_buffer[size];
@@ -895,6 +909,14 @@ MPI_Transfer::send(Correlation_parameters &corr_param, int rank) {
            message_buffer, size, &position, MPI_COMM_WORLD);
   MPI_Pack(&corr_param.window, 1, MPI_INT32,
            message_buffer, size, &position, MPI_COMM_WORLD);
+  MPI_Pack(&corr_param.correlation_threads, 1, MPI_INT32,
+           message_buffer, size, &position, MPI_COMM_WORLD);
+  MPI_Pack(&corr_param.bit2float_threads, 1, MPI_INT32,
+           message_buffer, size, &position, MPI_COMM_WORLD);
+  MPI_Pack(&wisdom_dir_len, 1, MPI_INT32,
+           message_buffer, size, &position, MPI_COMM_WORLD);
+  MPI_Pack((void *)corr_param.fftw_wisdom_dir.c_str(), wisdom_dir_len, MPI_CHAR,
+           message_buffer, size, &position, MPI_COMM_WORLD);
   MPI_Pack(&corr_param.integration_nr, 1, MPI_INT32,
            message_buffer, size, &position, MPI_COMM_WORLD);
   MPI_Pack(&corr_param.slice_nr, 1, MPI_INT32,
@@ -1028,6 +1050,21 @@ MPI_Transfer::receive(MPI_Status &status, Correlation_parameters &corr_param) {
   MPI_Unpack(buffer, size, &position,
              &corr_param.window, 1, MPI_INT32,
              MPI_COMM_WORLD);
+  MPI_Unpack(buffer, size, &position,
+             &corr_param.correlation_threads, 1, MPI_INT32,
+             MPI_COMM_WORLD);
+  MPI_Unpack(buffer, size, &position,
+             &corr_param.bit2float_threads, 1, MPI_INT32,
+             MPI_COMM_WORLD);
+  int32_t wisdom_dir_len;
+  MPI_Unpack(buffer, size, &position,
+             &wisdom_dir_len, 1, MPI_INT32,
+             MPI_COMM_WORLD);
+  char wisdom_dir[wisdom_dir_len];
+  MPI_Unpack(buffer, size, &position,
+             &wisdom_dir[0], wisdom_dir_len, MPI_CHAR,
+             MPI_COMM_WORLD);
+  corr_param.fftw_wisdom_dir = std::string(wisdom_dir);
   MPI_Unpack(buffer, size, &position,
              &corr_param.integration_nr, 1, MPI_INT32,
              MPI_COMM_WORLD);
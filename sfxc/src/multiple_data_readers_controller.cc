@@ -156,7 +156,7 @@ Multiple_data_readers_controller::process_event(MPI_Status &status) {
 
       int size;
       MPI_Get_elements(&status, MPI_CHAR, &size);
-      SFXC_ASSERT(size > sizeof(int32_t));
+      SFXC_ASSERT(size > sizeof(int32_t) + sizeof(Data_reader_parameters));
       char msg[size];
       char *p = msg;
       MPI_Recv(&msg, size, MPI_CHAR, status.MPI_SOURCE,
@@ -168,6 +168,10 @@ Multiple_data_readers_controller::process_event(MPI_Status &status) {
       memcpy(&stream_nr, p, sizeof(int32_t));
       size -= sizeof(int32_t);
       p += sizeof(int32_t);
+      Data_reader_parameters params;
+      memcpy(&params, p, sizeof(Data_reader_parameters));
+      size -= sizeof(Data_reader_parameters);
+      p += sizeof(Data_reader_parameters);
 
       // Make sure the array is null-terminated
       if (size > 0)
@@ -182,7 +186,7 @@ Multiple_data_readers_controller::process_event(MPI_Status &status) {
       SFXC_ASSERT(sources.size() > 0);
 
       shared_ptr<Data_reader>
-	reader(new Data_reader_file(sources));
+	reader(new Data_reader_file(sources, params));
       add_data_reader(stream_nr, reader);
 
       MPI_Send(&stream_nr, 1, MPI_INT32,
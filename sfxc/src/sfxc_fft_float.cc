@@ -1,5 +1,9 @@
 #include "sfxc_fft_float.h"
 #include "utils.h"
+#include "raiimutex.h"
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
 
 #ifdef USE_IPP
 #include <ippcore.h>
@@ -126,6 +130,28 @@ sfxc_fft_ipp_float::irfft(const std::complex<float> *in, float *out){
   ippsFFTInv_CCSToR_32f((Ipp32f *)in, (Ipp32f *)out, ippspec_r2c, buffer_r2c);
 }
 #else // USE FFTW
+// The fftw planner is not thread safe
+static Mutex planner_mutex;
+// The number of batched fft plans kept by each fft object
+#define MAX_MANY_PLANS 8
+// The rigor of the planner, sfxc-fft-tune raises it to create wisdom
+static unsigned int planner_flags = FFTW_ESTIMATE;
+// Set once wisdom has been imported. The tuned plans are then taken from the
+// wisdom with the rigor of sfxc-fft-tune, transforms that were not tuned
+// fall back to planner_flags
+static bool wisdom_imported = false;
+#define WISDOM_PLANNER_FLAGS (FFTW_PATIENT | FFTW_WISDOM_ONLY)
+
+// Fills the planner flags to try in turn, returns their number
+static int
+get_planner_flags(unsigned int flags[2]){
+  int n = 0;
+  if(wisdom_imported)
+    flags[n++] = WISDOM_PLANNER_FLAGS;
+  flags[n++] = planner_flags;
+  return n;
+}
+
 sfxc_fft_fftw_float::sfxc_fft_fftw_float(){
   plan_forward_set = false;
   plan_backward_set = false;
@@ -141,6 +167,7 @@ sfxc_fft_fftw_float::~sfxc_fft_fftw_float(){
 
 void
 sfxc_fft_fftw_float::free_buffers(){
+  RAIIMutex lock(planner_mutex);
   if(plan_forward_set){
     fftwf_destroy_plan(plan_forward);
     plan_forward_set = false;
@@ -165,6 +192,9 @@ sfxc_fft_fftw_float::free_buffers(){
     fftwf_destroy_plan(plan_backward_r2c);
     plan_backward_r2c_set = false;
   }
+  for(size_t i = 0; i < many_plans.size(); i++)
+    fftwf_destroy_plan(many_plans[i].plan);
+  many_plans.clear();
 }
 
 void
@@ -184,7 +214,12 @@ sfxc_fft_fftw_float::alloc(int sign, bool inplace){
   if((temp_in == NULL) || (temp_out == NULL))
     sfxc_abort("Unable to allocate buffer for fft\n");
 //  fftwf_plan plan = fftwf_plan_dft_1d(size, temp_in, temp_out, sign, FFTW_MEASURE);
-  fftwf_plan plan = fftwf_plan_dft_1d(size, temp_in, temp_out, sign, FFTW_ESTIMATE);
+  RAIIMutex lock(planner_mutex);
+  unsigned int flags[2];
+  const int nflags = get_planner_flags(flags);
+  fftwf_plan plan = NULL;
+  for(int i = 0; (i < nflags) && (plan == NULL); i++)
+    plan = fftwf_plan_dft_1d(size, temp_in, temp_out, sign, flags[i]);
   fftwf_free(temp_in);
   if(!inplace)
     fftwf_free(temp_out);
@@ -198,15 +233,21 @@ alloc_r2c(int sign){
   fftwf_complex *temp_complex = (fftwf_complex *)fftwf_malloc(size * sizeof(fftwf_complex));
   if((temp_real == NULL) || (temp_complex == NULL))
     sfxc_abort("Unable to allocate buffer for fft\n");
+  RAIIMutex lock(planner_mutex);
   fftwf_plan plan;
 //  if(sign == FFTW_FORWARD)
 //    plan = fftwf_plan_dft_r2c_1d(size, temp_real, temp_complex, FFTW_MEASURE);
 //  else
 //    plan = fftwf_plan_dft_c2r_1d(size, temp_complex, temp_real, FFTW_MEASURE);
-  if(sign == FFTW_FORWARD)
-    plan = fftwf_plan_dft_r2c_1d(size, temp_real, temp_complex, FFTW_ESTIMATE);
-  else
-    plan = fftwf_plan_dft_c2r_1d(size, temp_complex, temp_real, FFTW_ESTIMATE);
+  unsigned int flags[2];
+  const int nflags = get_planner_flags(flags);
+  plan = NULL;
+  for(int i = 0; (i < nflags) && (plan == NULL); i++){
+    if(sign == FFTW_FORWARD)
+      plan = fftwf_plan_dft_r2c_1d(size, temp_real, temp_complex, flags[i]);
+    else
+      plan = fftwf_plan_dft_c2r_1d(size, temp_complex, temp_real, flags[i]);
+  }
 
   fftwf_free(temp_real);
   fftwf_free(temp_complex);
@@ -266,4 +307,154 @@ sfxc_fft_fftw_float::irfft(const std::complex<float> *in, float *out){
   }
   fftwf_execute_dft_c2r(plan_backward_r2c, (fftwf_complex *)in, (float *)out);
 }
+
+void
+sfxc_fft_fftw_float::fft_many(const std::complex<float> *in, int idist,
+                              std::complex<float> *out, int odist, int howmany){
+  bool inplace = (in == out);
+  fftwf_plan plan = get_many_plan(MANY_FORWARD, howmany, idist, odist, inplace);
+  fftwf_execute_dft(plan, (fftwf_complex *)in, (fftwf_complex *)out);
+}
+
+void
+sfxc_fft_fftw_float::ifft_many(const std::complex<float> *in, int idist,
+                               std::complex<float> *out, int odist, int howmany){
+  bool inplace = (in == out);
+  fftwf_plan plan = get_many_plan(MANY_BACKWARD, howmany, idist, odist, inplace);
+  fftwf_execute_dft(plan, (fftwf_complex *)in, (fftwf_complex *)out);
+}
+
+void
+sfxc_fft_fftw_float::rfft_many(const float *in, int idist,
+                               std::complex<float> *out, int odist, int howmany){
+  SFXC_ASSERT((void *)in != (void *)out);
+  fftwf_plan plan = get_many_plan(MANY_R2C, howmany, idist, odist, false);
+  fftwf_execute_dft_r2c(plan, (float *)in, (fftwf_complex *)out);
+}
+
+void
+sfxc_fft_fftw_float::irfft_many(const std::complex<float> *in, int idist,
+                                float *out, int odist, int howmany){
+  SFXC_ASSERT((void *)in != (void *)out);
+  fftwf_plan plan = get_many_plan(MANY_C2R, howmany, idist, odist, false);
+  fftwf_execute_dft_c2r(plan, (fftwf_complex *)in, (float *)out);
+}
+
+fftwf_plan
+sfxc_fft_fftw_float::get_many_plan(many_type type, int howmany, int idist, int odist,
+                                   bool inplace){
+  for(size_t i = 0; i < many_plans.size(); i++){
+    many_plan &p = many_plans[i];
+    if((p.type == type) && (p.howmany == howmany) && (p.idist == idist) &&
+       (p.odist == odist) && (p.inplace == inplace))
+      return p.plan;
+  }
+
+  // Only keep the most recently created plans
+  if(many_plans.size() == MAX_MANY_PLANS){
+    RAIIMutex lock(planner_mutex);
+    fftwf_destroy_plan(many_plans[0].plan);
+    many_plans.erase(many_plans.begin());
+  }
+  many_plan p;
+  p.plan = alloc_many(type, howmany, idist, odist, inplace);
+  p.type = type;
+  p.howmany = howmany;
+  p.idist = idist;
+  p.odist = odist;
+  p.inplace = inplace;
+  many_plans.push_back(p);
+  return p.plan;
+}
+
+fftwf_plan
+sfxc_fft_fftw_float::alloc_many(many_type type, int howmany, int idist, int odist,
+                                bool inplace){
+  SFXC_ASSERT(howmany > 0);
+  // Element sizes of the input and output arrays
+  size_t in_size = sizeof(fftwf_complex), out_size = sizeof(fftwf_complex);
+  if(type == MANY_R2C)
+    in_size = sizeof(float);
+  else if(type == MANY_C2R)
+    out_size = sizeof(float);
+  void *temp_in = fftwf_malloc(std::max(howmany * idist * in_size,
+                                        howmany * odist * out_size));
+  void *temp_out;
+  if(inplace)
+    temp_out = temp_in;
+  else
+    temp_out = fftwf_malloc(howmany * odist * out_size);
+  if((temp_in == NULL) || (temp_out == NULL))
+    sfxc_abort("Unable to allocate buffer for fft\n");
+
+  RAIIMutex lock(planner_mutex);
+  unsigned int flags[2];
+  const int nflags = get_planner_flags(flags);
+  fftwf_plan plan = NULL;
+  for(int i = 0; (i < nflags) && (plan == NULL); i++){
+    switch(type){
+    case MANY_FORWARD:
+    case MANY_BACKWARD:
+      plan = fftwf_plan_many_dft(1, &size, howmany,
+                                 (fftwf_complex *)temp_in, NULL, 1, idist,
+                                 (fftwf_complex *)temp_out, NULL, 1, odist,
+                                 (type == MANY_FORWARD ? FFTW_FORWARD : FFTW_BACKWARD),
+                                 flags[i]);
+      break;
+    case MANY_R2C:
+      plan = fftwf_plan_many_dft_r2c(1, &size, howmany,
+                                     (float *)temp_in, NULL, 1, idist,
+                                     (fftwf_complex *)temp_out, NULL, 1, odist,
+                                     flags[i]);
+      break;
+    default:
+      plan = fftwf_plan_many_dft_c2r(1, &size, howmany,
+                                     (fftwf_complex *)temp_in, NULL, 1, idist,
+                                     (float *)temp_out, NULL, 1, odist,
+                                     flags[i]);
+    }
+  }
+  if(plan == NULL)
+    sfxc_abort("Unable to create batched fft plan\n");
+  fftwf_free(temp_in);
+  if(!inplace)
+    fftwf_free(temp_out);
+  return plan;
+}
+
+std::string
+sfxc_fft_fftw_float::wisdom_filename(const std::string &dir){
+  return dir + "/sfxc_fftw_float.wisdom";
+}
+
+bool
+sfxc_fft_fftw_float::import_wisdom(const std::string &filename){
+  RAIIMutex lock(planner_mutex);
+  if(fftwf_import_wisdom_from_filename(filename.c_str()) == 0)
+    return false;
+  wisdom_imported = true;
+  return true;
+}
+
+bool
+sfxc_fft_fftw_float::export_wisdom(const std::string &filename){
+  RAIIMutex lock(planner_mutex);
+  // Several nodes may share the wisdom file, therefore the new wisdom is
+  // written to a temporary file that replaces the old file in one go
+  std::stringstream tmp_filename;
+  tmp_filename << filename << "." << getpid();
+  if(!fftwf_export_wisdom_to_filename(tmp_filename.str().c_str()))
+    return false;
+  if(rename(tmp_filename.str().c_str(), filename.c_str()) != 0){
+    unlink(tmp_filename.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+void
+sfxc_fft_fftw_float::set_planner_flags(unsigned int flags){
+  RAIIMutex lock(planner_mutex);
+  planner_flags = flags;
+}
 #endif // USE_IPP
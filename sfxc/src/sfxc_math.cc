@@ -0,0 +1,603 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - Vectorised math kernels of the correlator.
+ */
+
+#include "sfxc_math.h"
+#include "sfxc_simd.h"
+#include <string.h>
+#include <algorithm>
+
+// Conjugate-multiply-accumulate kernels: dest += s1 * conj(s2)
+//
+// The vectorised versions are compiled with the target attribute, so the
+// rest of sfxc does not have to be built for a specific instruction set.
+// The best version for the CPU we run on is selected on the first call.
+namespace {
+
+typedef void (*add_product_conj_fc_t)(const std::complex<float> *,
+                                      const std::complex<float> *,
+                                      std::complex<float> *, int);
+typedef void (*add_product_conj_c_t)(const std::complex<double> *,
+                                     const std::complex<double> *,
+                                     std::complex<double> *, int);
+
+template <class T>
+inline void add_product_conj_scalar(const std::complex<T> *s1,
+                                    const std::complex<T> *s2,
+                                    std::complex<T> *dest, int len) {
+  // Written out explicitly, std::complex multiplication has to handle
+  // infinities and NaNs which makes it considerably slower
+  const T *a = (const T *)s1;
+  const T *b = (const T *)s2;
+  T *c = (T *)dest;
+  for (int i = 0; i < 2 * len; i += 2) {
+    c[i]     += a[i] * b[i] + a[i + 1] * b[i + 1];
+    c[i + 1] += a[i + 1] * b[i] - a[i] * b[i + 1];
+  }
+}
+
+// Not inlined into the vectorised kernels, whose target may allow the
+// compiler to contract the products into fma
+__attribute__((noinline))
+void add_product_conj_fc_scalar(const std::complex<float> *s1,
+                                const std::complex<float> *s2,
+                                std::complex<float> *dest, int len) {
+  add_product_conj_scalar(s1, s2, dest, len);
+}
+
+__attribute__((noinline))
+void add_product_conj_c_scalar(const std::complex<double> *s1,
+                               const std::complex<double> *s2,
+                               std::complex<double> *dest, int len) {
+  add_product_conj_scalar(s1, s2, dest, len);
+}
+
+#ifdef SFXC_X86_SIMD
+// With a = (ar, ai) and b = (br, bi), a * conj(b) is
+//   (ar * br + ai * bi, ai * br - ar * bi)
+// The products are rounded separately and summed in the same order as in
+// the scalar version, without fma. The result is then the same on every
+// cpu, and the imaginary part of an autocorrelation is exactly zero.
+
+__attribute__((target("avx")))
+void add_product_conj_fc_avx(const std::complex<float> *s1,
+                             const std::complex<float> *s2,
+                             std::complex<float> *dest, int len) {
+  const float *a = (const float *)s1;
+  const float *b = (const float *)s2;
+  float *c = (float *)dest;
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m256 va = _mm256_loadu_ps(a + 2 * i);
+    __m256 vb = _mm256_loadu_ps(b + 2 * i);
+    __m256 vc = _mm256_loadu_ps(c + 2 * i);
+    __m256 b_re = _mm256_moveldup_ps(vb);
+    __m256 b_im = _mm256_movehdup_ps(vb);
+    __m256 a_swap = _mm256_permute_ps(va, 0xB1);
+    // (ar * br, ai * br) -/+ (-ai * bi, -ar * bi)
+    __m256 prod = _mm256_addsub_ps(_mm256_mul_ps(va, b_re),
+                                   _mm256_xor_ps(_mm256_mul_ps(a_swap, b_im), sign));
+    _mm256_storeu_ps(c + 2 * i, _mm256_add_ps(vc, prod));
+  }
+  add_product_conj_fc_scalar(s1 + i, s2 + i, dest + i, len - i);
+}
+
+__attribute__((target("avx")))
+void add_product_conj_c_avx(const std::complex<double> *s1,
+                            const std::complex<double> *s2,
+                            std::complex<double> *dest, int len) {
+  const double *a = (const double *)s1;
+  const double *b = (const double *)s2;
+  double *c = (double *)dest;
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  int i = 0;
+  for (; i + 2 <= len; i += 2) {
+    __m256d va = _mm256_loadu_pd(a + 2 * i);
+    __m256d vb = _mm256_loadu_pd(b + 2 * i);
+    __m256d vc = _mm256_loadu_pd(c + 2 * i);
+    __m256d b_re = _mm256_movedup_pd(vb);
+    __m256d b_im = _mm256_permute_pd(vb, 0xF);
+    __m256d a_swap = _mm256_permute_pd(va, 0x5);
+    __m256d prod = _mm256_addsub_pd(_mm256_mul_pd(va, b_re),
+                                    _mm256_xor_pd(_mm256_mul_pd(a_swap, b_im), sign));
+    _mm256_storeu_pd(c + 2 * i, _mm256_add_pd(vc, prod));
+  }
+  add_product_conj_c_scalar(s1 + i, s2 + i, dest + i, len - i);
+}
+
+// AVX-512 has no addsub, the real and imaginary lanes are added and
+// subtracted with masks instead
+__attribute__((target("avx512f")))
+void add_product_conj_fc_avx512(const std::complex<float> *s1,
+                                const std::complex<float> *s2,
+                                std::complex<float> *dest, int len) {
+  const float *a = (const float *)s1;
+  const float *b = (const float *)s2;
+  float *c = (float *)dest;
+  const __mmask16 real = 0x5555, imag = 0xAAAA;
+  int i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m512 va = _mm512_loadu_ps(a + 2 * i);
+    __m512 vb = _mm512_loadu_ps(b + 2 * i);
+    __m512 vc = _mm512_loadu_ps(c + 2 * i);
+    __m512 b_re = _mm512_moveldup_ps(vb);
+    __m512 b_im = _mm512_movehdup_ps(vb);
+    __m512 a_swap = _mm512_permute_ps(va, 0xB1);
+    __m512 x = _mm512_mul_ps(va, b_re);
+    __m512 y = _mm512_mul_ps(a_swap, b_im);
+    __m512 prod = _mm512_mask_sub_ps(_mm512_maskz_add_ps(real, x, y), imag, x, y);
+    _mm512_storeu_ps(c + 2 * i, _mm512_add_ps(vc, prod));
+  }
+  add_product_conj_fc_scalar(s1 + i, s2 + i, dest + i, len - i);
+}
+
+__attribute__((target("avx512f")))
+void add_product_conj_c_avx512(const std::complex<double> *s1,
+                               const std::complex<double> *s2,
+                               std::complex<double> *dest, int len) {
+  const double *a = (const double *)s1;
+  const double *b = (const double *)s2;
+  double *c = (double *)dest;
+  const __mmask8 real = 0x55, imag = 0xAA;
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m512d va = _mm512_loadu_pd(a + 2 * i);
+    __m512d vb = _mm512_loadu_pd(b + 2 * i);
+    __m512d vc = _mm512_loadu_pd(c + 2 * i);
+    __m512d b_re = _mm512_movedup_pd(vb);
+    __m512d b_im = _mm512_permute_pd(vb, 0xFF);
+    __m512d a_swap = _mm512_permute_pd(va, 0x55);
+    __m512d x = _mm512_mul_pd(va, b_re);
+    __m512d y = _mm512_mul_pd(a_swap, b_im);
+    __m512d prod = _mm512_mask_sub_pd(_mm512_maskz_add_pd(real, x, y), imag, x, y);
+    _mm512_storeu_pd(c + 2 * i, _mm512_add_pd(vc, prod));
+  }
+  add_product_conj_c_scalar(s1 + i, s2 + i, dest + i, len - i);
+}
+#endif // SFXC_X86_SIMD
+
+add_product_conj_fc_t select_add_product_conj_fc() {
+#ifdef SFXC_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return add_product_conj_fc_avx512;
+  if (__builtin_cpu_supports("avx"))
+    return add_product_conj_fc_avx;
+#endif
+  return add_product_conj_fc_scalar;
+}
+
+add_product_conj_c_t select_add_product_conj_c() {
+#ifdef SFXC_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return add_product_conj_c_avx512;
+  if (__builtin_cpu_supports("avx"))
+    return add_product_conj_c_avx;
+#endif
+  return add_product_conj_c_scalar;
+}
+
+} // end namespace
+
+void sfxc_add_product_conj_fc(const std::complex<float> *s1, const std::complex<float> *s2, std::complex<float> *dest, int len){
+  static const add_product_conj_fc_t kernel = select_add_product_conj_fc();
+  kernel(s1, s2, dest, len);
+}
+
+void sfxc_add_product_conj_c(const std::complex<double> *s1, const std::complex<double> *s2, std::complex<double> *dest, int len){
+  static const add_product_conj_c_t kernel = select_add_product_conj_c();
+  kernel(s1, s2, dest, len);
+}
+
+// Phasor rotation kernels. The phasor of point i is
+//   amplitude * exp(j * (phase + i * delta))
+// The vectorised versions advance several phasors at once with a complex
+// recurrence. Every PHASOR_RESYNC points the phasors are computed again
+// with sin and cos, which bounds the accumulated rounding error.
+namespace {
+
+const int PHASOR_RESYNC = 256;
+
+enum Rotate_op {
+  ROTATE,      // data[i] *= phasor
+  ROTATE_REAL, // out[i] = Re(in[i] * phasor)
+  ADD_ROTATED  // out[i] += in[i] * phasor
+};
+
+inline void phasor_sincos(double phi, double *sin_phi, double *cos_phi) {
+#ifdef HAVE_SINCOS
+  sincos(phi, sin_phi, cos_phi);
+#else
+  *sin_phi = sin(phi);
+  *cos_phi = cos(phi);
+#endif
+}
+
+// The output is complex for ROTATE and ADD_ROTATED and real for ROTATE_REAL,
+// in all cases it is passed as a pointer to the (real) elements
+template <class T, int OP>
+void rotate_scalar(const std::complex<T> *in, T *out, int len,
+                   double phase, double delta, double amplitude) {
+  const T *a = (const T *)in;
+  // in the loop we calculate sin(phi) and cos(phi) using the recurrence
+  // sin(t+delta)=sin(t)-[a*sin(t)-b*cos(t)] ; cos(t+delta)=cos(t)-[a*cos(t)+b*sin(t)]
+  // a=2*sin^2(delta/2) ; b=sin(delta)
+  double temp = sin(delta / 2);
+  const double ra = 2 * temp * temp, rb = sin(delta);
+  for (int start = 0; start < len; start += PHASOR_RESYNC) {
+    const int end = std::min(len, start + PHASOR_RESYNC);
+    double sin_phi, cos_phi;
+    phasor_sincos(phase + start * delta, &sin_phi, &cos_phi);
+    sin_phi *= amplitude;
+    cos_phi *= amplitude;
+    for (int i = start; i < end; i++) {
+      const T re = a[2 * i], im = a[2 * i + 1];
+      if (OP == ROTATE) {
+        out[2 * i]     = re * cos_phi - im * sin_phi;
+        out[2 * i + 1] = re * sin_phi + im * cos_phi;
+      } else if (OP == ROTATE_REAL) {
+        out[i] = re * cos_phi - im * sin_phi;
+      } else {
+        out[2 * i]     += re * cos_phi - im * sin_phi;
+        out[2 * i + 1] += re * sin_phi + im * cos_phi;
+      }
+      temp = sin_phi - (ra * sin_phi - rb * cos_phi);
+      cos_phi = cos_phi - (ra * cos_phi + rb * sin_phi);
+      sin_phi = temp;
+    }
+  }
+}
+
+template <int OP>
+void rotate_fc_scalar(const std::complex<float> *in, float *out, int len,
+                      double phase, double delta, double amplitude) {
+  rotate_scalar<float, OP>(in, out, len, phase, delta, amplitude);
+}
+
+template <int OP>
+void rotate_c_scalar(const std::complex<double> *in, double *out, int len,
+                     double phase, double delta, double amplitude) {
+  rotate_scalar<double, OP>(in, out, len, phase, delta, amplitude);
+}
+
+typedef void (*rotate_fc_t)(const std::complex<float> *, float *, int,
+                            double, double, double);
+typedef void (*rotate_c_t)(const std::complex<double> *, double *, int,
+                           double, double, double);
+
+#ifdef SFXC_X86_SIMD
+// Complex multiplication of interleaved (re, im) pairs:
+//   a * b = fmaddsub(a, (br, br), (ai * bi, ar * bi))
+
+// Eight phasors in two registers of four complex floats
+template <int OP>
+__attribute__((target("avx2,fma")))
+void rotate_fc_avx2(const std::complex<float> *in, float *out, int len,
+                    double phase, double delta, double amplitude) {
+  const float *a = (const float *)in;
+  double step_sin, step_cos;
+  phasor_sincos(8 * delta, &step_sin, &step_cos);
+  const __m256 s_re = _mm256_set1_ps(step_cos);
+  const __m256 s_im = _mm256_set1_ps(step_sin);
+  int i = 0;
+  while (i + 8 <= len) {
+    const int end = i + (std::min(len - i, PHASOR_RESYNC) & ~7);
+    float p[16];
+    for (int k = 0; k < 8; k++) {
+      double sin_phi, cos_phi;
+      phasor_sincos(phase + (i + k) * delta, &sin_phi, &cos_phi);
+      p[2 * k] = amplitude * cos_phi;
+      p[2 * k + 1] = amplitude * sin_phi;
+    }
+    __m256 p0 = _mm256_loadu_ps(p), p1 = _mm256_loadu_ps(p + 8);
+    for (; i < end; i += 8) {
+      __m256 x0 = _mm256_loadu_ps(a + 2 * i);
+      __m256 x1 = _mm256_loadu_ps(a + 2 * i + 8);
+      if (OP == ROTATE_REAL) {
+        // Re(x * p) = xr * pr - xi * pi
+        __m256 h = _mm256_hsub_ps(_mm256_mul_ps(x0, p0), _mm256_mul_ps(x1, p1));
+        h = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(h), 0xD8));
+        _mm256_storeu_ps(out + i, h);
+      } else {
+        __m256 y0 = _mm256_fmaddsub_ps(x0, _mm256_moveldup_ps(p0),
+                      _mm256_mul_ps(_mm256_permute_ps(x0, 0xB1), _mm256_movehdup_ps(p0)));
+        __m256 y1 = _mm256_fmaddsub_ps(x1, _mm256_moveldup_ps(p1),
+                      _mm256_mul_ps(_mm256_permute_ps(x1, 0xB1), _mm256_movehdup_ps(p1)));
+        if (OP == ADD_ROTATED) {
+          y0 = _mm256_add_ps(y0, _mm256_loadu_ps(out + 2 * i));
+          y1 = _mm256_add_ps(y1, _mm256_loadu_ps(out + 2 * i + 8));
+        }
+        _mm256_storeu_ps(out + 2 * i, y0);
+        _mm256_storeu_ps(out + 2 * i + 8, y1);
+      }
+      p0 = _mm256_fmaddsub_ps(p0, s_re, _mm256_mul_ps(_mm256_permute_ps(p0, 0xB1), s_im));
+      p1 = _mm256_fmaddsub_ps(p1, s_re, _mm256_mul_ps(_mm256_permute_ps(p1, 0xB1), s_im));
+    }
+  }
+  rotate_scalar<float, OP>(in + i, out + (OP == ROTATE_REAL ? i : 2 * i), len - i,
+                           phase + i * delta, delta, amplitude);
+}
+
+// Four phasors in two registers of two complex doubles
+template <int OP>
+__attribute__((target("avx2,fma")))
+void rotate_c_avx2(const std::complex<double> *in, double *out, int len,
+                   double phase, double delta, double amplitude) {
+  const double *a = (const double *)in;
+  double step_sin, step_cos;
+  phasor_sincos(4 * delta, &step_sin, &step_cos);
+  const __m256d s_re = _mm256_set1_pd(step_cos);
+  const __m256d s_im = _mm256_set1_pd(step_sin);
+  int i = 0;
+  while (i + 4 <= len) {
+    const int end = i + (std::min(len - i, PHASOR_RESYNC) & ~3);
+    double p[8];
+    for (int k = 0; k < 4; k++) {
+      phasor_sincos(phase + (i + k) * delta, &p[2 * k + 1], &p[2 * k]);
+      p[2 * k] *= amplitude;
+      p[2 * k + 1] *= amplitude;
+    }
+    __m256d p0 = _mm256_loadu_pd(p), p1 = _mm256_loadu_pd(p + 4);
+    for (; i < end; i += 4) {
+      __m256d x0 = _mm256_loadu_pd(a + 2 * i);
+      __m256d x1 = _mm256_loadu_pd(a + 2 * i + 4);
+      if (OP == ROTATE_REAL) {
+        __m256d h = _mm256_hsub_pd(_mm256_mul_pd(x0, p0), _mm256_mul_pd(x1, p1));
+        _mm256_storeu_pd(out + i, _mm256_permute4x64_pd(h, 0xD8));
+      } else {
+        __m256d y0 = _mm256_fmaddsub_pd(x0, _mm256_movedup_pd(p0),
+                       _mm256_mul_pd(_mm256_permute_pd(x0, 0x5), _mm256_permute_pd(p0, 0xF)));
+        __m256d y1 = _mm256_fmaddsub_pd(x1, _mm256_movedup_pd(p1),
+                       _mm256_mul_pd(_mm256_permute_pd(x1, 0x5), _mm256_permute_pd(p1, 0xF)));
+        if (OP == ADD_ROTATED) {
+          y0 = _mm256_add_pd(y0, _mm256_loadu_pd(out + 2 * i));
+          y1 = _mm256_add_pd(y1, _mm256_loadu_pd(out + 2 * i + 4));
+        }
+        _mm256_storeu_pd(out + 2 * i, y0);
+        _mm256_storeu_pd(out + 2 * i + 4, y1);
+      }
+      p0 = _mm256_fmaddsub_pd(p0, s_re, _mm256_mul_pd(_mm256_permute_pd(p0, 0x5), s_im));
+      p1 = _mm256_fmaddsub_pd(p1, s_re, _mm256_mul_pd(_mm256_permute_pd(p1, 0x5), s_im));
+    }
+  }
+  rotate_scalar<double, OP>(in + i, out + (OP == ROTATE_REAL ? i : 2 * i), len - i,
+                            phase + i * delta, delta, amplitude);
+}
+#endif // SFXC_X86_SIMD
+
+template <int OP>
+rotate_fc_t select_rotate_fc() {
+#ifdef SFXC_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return rotate_fc_avx2<OP>;
+#endif
+  return rotate_fc_scalar<OP>;
+}
+
+template <int OP>
+rotate_c_t select_rotate_c() {
+#ifdef SFXC_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return rotate_c_avx2<OP>;
+#endif
+  return rotate_c_scalar<OP>;
+}
+
+} // end namespace
+
+void sfxc_rotate_fc(std::complex<float> *data, int len, double phase, double delta, double amplitude){
+  static const rotate_fc_t kernel = select_rotate_fc<ROTATE>();
+  kernel(data, (float *)data, len, phase, delta, amplitude);
+}
+
+void sfxc_rotate_c(std::complex<double> *data, int len, double phase, double delta, double amplitude){
+  static const rotate_c_t kernel = select_rotate_c<ROTATE>();
+  kernel(data, (double *)data, len, phase, delta, amplitude);
+}
+
+void sfxc_rotate_real_fc(const std::complex<float> *in, float *out, int len, double phase, double delta, double amplitude){
+  static const rotate_fc_t kernel = select_rotate_fc<ROTATE_REAL>();
+  kernel(in, out, len, phase, delta, amplitude);
+}
+
+void sfxc_rotate_real_c(const std::complex<double> *in, double *out, int len, double phase, double delta, double amplitude){
+  static const rotate_c_t kernel = select_rotate_c<ROTATE_REAL>();
+  kernel(in, out, len, phase, delta, amplitude);
+}
+
+void sfxc_add_rotated_fc(const std::complex<float> *in, std::complex<float> *out, int len, double phase, double delta, double amplitude){
+  static const rotate_fc_t kernel = select_rotate_fc<ADD_ROTATED>();
+  kernel(in, (float *)out, len, phase, delta, amplitude);
+}
+
+void sfxc_add_rotated_c(const std::complex<double> *in, std::complex<double> *out, int len, double phase, double delta, double amplitude){
+  static const rotate_c_t kernel = select_rotate_c<ADD_ROTATED>();
+  kernel(in, (double *)out, len, phase, delta, amplitude);
+}
+
+// Bit unpacking kernels. Every input byte holds four 2 bit or eight 1 bit
+// samples, the first sample in the least significant bits. Each sample is
+// replaced by its level and the number of samples at every level is counted
+// in the same pass.
+namespace {
+
+// Adds the number of samples at every level in n bytes to counts
+template <int BITS>
+void count_levels_scalar(const unsigned char *in, int n, int64_t *counts) {
+  const uint64_t lsb = 0x5555555555555555ULL;
+  int64_t c1 = 0, c2 = 0, c3 = 0;
+  for (int i = 0; i < n; i += 8) {
+    uint64_t w = 0;
+    memcpy(&w, in + i, std::min(8, n - i));
+    if (BITS == 2) {
+      const uint64_t lo = w & lsb, hi = (w >> 1) & lsb;
+      c1 += __builtin_popcountll(lo & ~hi);
+      c2 += __builtin_popcountll(hi & ~lo);
+      c3 += __builtin_popcountll(lo & hi);
+    } else {
+      c1 += __builtin_popcountll(w);
+    }
+  }
+  if (BITS == 2) {
+    counts[0] += 4 * (int64_t)n - c1 - c2 - c3;
+    counts[1] += c1;
+    counts[2] += c2;
+    counts[3] += c3;
+  } else {
+    counts[0] += 8 * (int64_t)n - c1;
+    counts[1] += c1;
+  }
+}
+
+template <class T, int BITS>
+void unpack_scalar(const unsigned char *in, int n, const T *levels, T *out,
+                   int64_t *counts) {
+  const int samples_per_byte = 8 / BITS, mask = (1 << BITS) - 1;
+  for (int i = 0; i < n; i++) {
+    const int byte = in[i];
+    for (int j = 0; j < samples_per_byte; j++)
+      out[samples_per_byte * i + j] = levels[(byte >> (BITS * j)) & mask];
+  }
+  count_levels_scalar<BITS>(in, n, counts);
+}
+
+#ifdef SFXC_X86_SIMD
+__attribute__((target("avx2")))
+inline void store_levels(float *out, __m256 v) {
+  _mm256_storeu_ps(out, v);
+}
+
+__attribute__((target("avx2")))
+inline void store_levels(double *out, __m256 v) {
+  _mm256_storeu_pd(out, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+  _mm256_storeu_pd(out + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+}
+
+// Number of bits set in each 64 bit lane of v
+__attribute__((target("avx2")))
+inline __m256i popcount_epi64(__m256i v) {
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  __m256i cnt = _mm256_add_epi8(
+    _mm256_shuffle_epi8(lut, _mm256_and_si256(v, nibble)),
+    _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+inline int64_t sum_epi64(__m256i v) {
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, v);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Unpacks 32 bytes per iteration. A byte (1 bit) or a pair of bytes (2 bit)
+// is broadcast to eight lanes and shifted so that every lane holds one
+// sample, vpermps then looks up the levels. The level counts are kept in
+// registers using popcounts of the sample bits.
+template <class T, int BITS>
+__attribute__((target("avx2")))
+void unpack_avx2(const unsigned char *in, int n, const T *levels, T *out,
+                 int64_t *counts) {
+  // The levels are looked up as floats
+  for (int k = 0; k < (1 << BITS); k++) {
+    if ((T)(float)levels[k] != levels[k]) {
+      unpack_scalar<T, BITS>(in, n, levels, out, counts);
+      return;
+    }
+  }
+  // vpermps only uses the lowest three bits of the index, hence the levels
+  // are repeated
+  const float l0 = levels[0], l1 = levels[1];
+  const float l2 = levels[BITS == 2 ? 2 : 0], l3 = levels[BITS == 2 ? 3 : 1];
+  const __m256 lut = _mm256_setr_ps(l0, l1, l2, l3, l0, l1, l2, l3);
+  const __m256i shifts = (BITS == 2 ? _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14)
+                                    : _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  const __m256i lsb = _mm256_set1_epi8(0x55);
+  __m256i c1 = _mm256_setzero_si256();
+  __m256i c2 = _mm256_setzero_si256();
+  __m256i c3 = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+    if (BITS == 2) {
+      const __m256i lo = _mm256_and_si256(v, lsb);
+      const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 1), lsb);
+      c1 = _mm256_add_epi64(c1, popcount_epi64(_mm256_andnot_si256(hi, lo)));
+      c2 = _mm256_add_epi64(c2, popcount_epi64(_mm256_andnot_si256(lo, hi)));
+      c3 = _mm256_add_epi64(c3, popcount_epi64(_mm256_and_si256(lo, hi)));
+      for (int j = 0; j < 32; j += 2) {
+        const int pair = in[i + j] | (in[i + j + 1] << 8);
+        const __m256i idx = _mm256_srlv_epi32(_mm256_set1_epi32(pair), shifts);
+        store_levels(out + 4 * (i + j), _mm256_permutevar8x32_ps(lut, idx));
+      }
+    } else {
+      c1 = _mm256_add_epi64(c1, popcount_epi64(v));
+      for (int j = 0; j < 32; j++) {
+        const __m256i idx = _mm256_srlv_epi32(_mm256_set1_epi32(in[i + j]), shifts);
+        store_levels(out + 8 * (i + j), _mm256_permutevar8x32_ps(lut, idx));
+      }
+    }
+  }
+  if (BITS == 2) {
+    const int64_t n1 = sum_epi64(c1), n2 = sum_epi64(c2), n3 = sum_epi64(c3);
+    counts[0] += 4 * (int64_t)i - n1 - n2 - n3;
+    counts[1] += n1;
+    counts[2] += n2;
+    counts[3] += n3;
+  } else {
+    const int64_t n1 = sum_epi64(c1);
+    counts[0] += 8 * (int64_t)i - n1;
+    counts[1] += n1;
+  }
+  unpack_scalar<T, BITS>(in + i, n - i, levels, out + (8 / BITS) * i, counts);
+}
+#endif // SFXC_X86_SIMD
+
+template <class T>
+struct Unpack_kernel {
+  typedef void (*type)(const unsigned char *, int, const T *, T *, int64_t *);
+};
+
+template <class T, int BITS>
+typename Unpack_kernel<T>::type select_unpack() {
+#ifdef SFXC_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return unpack_avx2<T, BITS>;
+#endif
+  return unpack_scalar<T, BITS>;
+}
+
+} // end namespace
+
+void sfxc_unpack_2bit_f(const unsigned char *in, int nbytes, const float *levels, float *out, int64_t *counts){
+  static const Unpack_kernel<float>::type kernel = select_unpack<float, 2>();
+  kernel(in, nbytes, levels, out, counts);
+}
+
+void sfxc_unpack_2bit(const unsigned char *in, int nbytes, const double *levels, double *out, int64_t *counts){
+  static const Unpack_kernel<double>::type kernel = select_unpack<double, 2>();
+  kernel(in, nbytes, levels, out, counts);
+}
+
+void sfxc_unpack_1bit_f(const unsigned char *in, int nbytes, const float *levels, float *out, int64_t *counts){
+  static const Unpack_kernel<float>::type kernel = select_unpack<float, 1>();
+  kernel(in, nbytes, levels, out, counts);
+}
+
+void sfxc_unpack_1bit(const unsigned char *in, int nbytes, const double *levels, double *out, int64_t *counts){
+  static const Unpack_kernel<double>::type kernel = select_unpack<double, 1>();
+  kernel(in, nbytes, levels, out, counts);
+}
@@ -25,7 +25,7 @@ Single_data_reader_controller::process_event(MPI_Status &status) {
 
       int size;
       MPI_Get_elements(&status, MPI_CHAR, &size);
-      SFXC_ASSERT(size > sizeof(int32_t));
+      SFXC_ASSERT(size > sizeof(int32_t) + sizeof(Data_reader_parameters));
       char msg[size];
       char *p = msg;
       MPI_Recv(&msg, size, MPI_CHAR, status.MPI_SOURCE,
@@ -37,6 +37,10 @@ Single_data_reader_controller::process_event(MPI_Status &status) {
       memcpy(&stream_nr, p, sizeof(int32_t));
       size -= sizeof(int32_t);
       p += sizeof(int32_t);
+      Data_reader_parameters params;
+      memcpy(&params, p, sizeof(Data_reader_parameters));
+      size -= sizeof(Data_reader_parameters);
+      p += sizeof(Data_reader_parameters);
 
       // Make sure the array is null-terminated
       if (size > 0)
@@ -50,7 +54,7 @@ Single_data_reader_controller::process_event(MPI_Status &status) {
       }
       SFXC_ASSERT(sources.size() > 0);
 
-      shared_ptr<Data_reader> reader(Data_reader_factory::get_reader(sources));
+      shared_ptr<Data_reader> reader(Data_reader_factory::get_reader(sources, params));
 
       set_data_reader(stream_nr, reader);
 
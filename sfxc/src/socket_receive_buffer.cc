@@ -0,0 +1,97 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ *
+ * This file is part of:
+ *   - SFXC/SCARIe project.
+ * This file contains:
+ *   - A receive buffer for stream sockets.
+ */
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "socket_receive_buffer.h"
+#include "utils.h"
+
+Socket_receive_buffer::Socket_receive_buffer()
+  : buffer(NULL), buffer_pos(0), buffer_end(0), can_truncate(-1) {
+  if (posix_memalign((void **)&buffer, 4096, SOCKET_RECEIVE_BUFFER_SIZE) != 0)
+    sfxc_abort("Could not allocate socket receive buffer");
+}
+
+Socket_receive_buffer::~Socket_receive_buffer() {
+  free(buffer);
+}
+
+ssize_t
+Socket_receive_buffer::receive(int fd, size_t nbytes, char *out) {
+  if (out == NULL)
+    return skip(fd, nbytes);
+
+  if (bytes_buffered() > 0) {
+    const size_t n = std::min(nbytes, bytes_buffered());
+    memcpy(out, buffer + buffer_pos, n);
+    buffer_pos += n;
+    return n;
+  }
+
+  ssize_t n;
+  if (nbytes >= SOCKET_DIRECT_READ_SIZE) {
+    do {
+      n = ::recv(fd, out, nbytes, MSG_WAITALL);
+    } while ((n < 0) && (errno == EINTR));
+    return n;
+  }
+
+  do {
+    n = ::recv(fd, buffer, SOCKET_RECEIVE_BUFFER_SIZE, 0);
+  } while ((n < 0) && (errno == EINTR));
+  if (n <= 0)
+    return n;
+  buffer_pos = std::min(nbytes, (size_t)n);
+  buffer_end = n;
+  memcpy(out, buffer, buffer_pos);
+  return buffer_pos;
+}
+
+ssize_t
+Socket_receive_buffer::skip(int fd, size_t nbytes) {
+  if (bytes_buffered() > 0) {
+    const size_t n = std::min(nbytes, bytes_buffered());
+    buffer_pos += n;
+    return n;
+  }
+
+  ssize_t n;
+#ifdef __linux__
+  if (can_truncate < 0) {
+    // Only TCP discards the data of recv(MSG_TRUNC) on a stream socket
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    int type;
+    socklen_t type_len = sizeof(type);
+    can_truncate =
+      (::getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0) &&
+      ((addr.ss_family == AF_INET) || (addr.ss_family == AF_INET6)) &&
+      (::getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_len) == 0) &&
+      (type == SOCK_STREAM);
+  }
+  if (can_truncate) {
+    do {
+      n = ::recv(fd, NULL, nbytes, MSG_TRUNC);
+    } while ((n < 0) && (errno == EINTR));
+    return n;
+  }
+#endif
+
+  do {
+    n = ::recv(fd, buffer, std::min(nbytes, SOCKET_RECEIVE_BUFFER_SIZE), 0);
+  } while ((n < 0) && (errno == EINTR));
+  return n;
+}
@@ -6,7 +6,7 @@ VDIF_reader::VDIF_reader(shared_ptr<Data_reader> data_reader,
   : Input_data_format_reader(data_reader),
     debug_level_(CHECK_PERIODIC_HEADERS),
     sample_rate(0), first_header_seen(false),
-    frame_size(0)
+    frame_size(0), read_buffer_pos(0), read_buffer_end(0)
 {
   ref_jday = (int)ref_time.get_mjd();
 }
@@ -61,6 +61,11 @@ VDIF_reader::goto_time(Data_frame &data, Time time) {
         break;
     }
   } else if (time > get_current_time()) {
+    // Skip to the last header before time that is in the index
+    Data_index::Checkpoint checkpoint;
+    if (goto_indexed_time(time, checkpoint) && !read_new_block(data))
+      return get_current_time();
+
     // FIXME nthreads will be smaller than the actual number of threads when
     // correlating a subset of all channels, causing goto_time to take smaller steps. 
     // Currently, the input node doesn't know how many threads were recorded to disk.
@@ -75,7 +80,7 @@ VDIF_reader::goto_time(Data_frame &data, Time time) {
       size_t n_blocks = nthreads * (one_sec / time_between_headers_);
       // Don't read the last header, to be able to check whether we are at the right time
       size_t bytes_to_read = (n_blocks-1) * vdif_block_size;
-      size_t byte_read = Data_reader_blocking::get_bytes_s( data_reader_.get(), bytes_to_read, NULL );
+      size_t byte_read = skip_bytes(bytes_to_read);
       if (bytes_to_read != byte_read)
         return get_current_time();
 
@@ -88,6 +93,7 @@ VDIF_reader::goto_time(Data_frame &data, Time time) {
       if (!read_new_block(data))
         break;
     }
+    save_index();
   }
   return get_current_time();
 }
@@ -114,11 +120,16 @@ VDIF_reader::read_new_block(Data_frame &data) {
   std::vector<value_type> &buffer = data.buffer->data;
   const int max_restarts = 256;
   int restarts = 0;
+  uint64_t header_pos;
+
+  // Common case: a block of valid frames in the read buffer
+  if (first_header_seen && read_frames(data))
+    return true;
 
  restart:
+  header_pos = data_reader_->data_counter() - bytes_buffered();
   if (!first_header_seen) {
-    Data_reader_blocking::get_bytes_s(data_reader_.get(), 16, (char *)&current_header);
-    if (data_reader_->eof())
+    if (read_bytes(16, (char *)&current_header) != 16)
       return false;
     if (((uint32_t *)&current_header)[0] == 0x11223344 ||
         ((uint32_t *)&current_header)[1] == 0x11223344 ||
@@ -126,7 +137,7 @@ VDIF_reader::read_new_block(Data_frame &data) {
         ((uint32_t *)&current_header)[3] == 0x11223344) {
       LOG_MSG(": VDIF_READER, fill pattern in header, frame_size =" << frame_size);
       // NB we default to non-legacy VDIF, at this point there is no way to tell
-      Data_reader_blocking::get_bytes_s(data_reader_.get(), frame_size + 16, NULL);
+      read_bytes(frame_size + 16, NULL);
       if (++restarts > max_restarts)
         return false;
       goto restart;
@@ -137,17 +148,12 @@ VDIF_reader::read_new_block(Data_frame &data) {
       // FIXME : If first header has fill pattern this will fail
       // We should use the information that vex2 provides
       char *header = (char *)&current_header;
-      Data_reader_blocking::get_bytes_s(data_reader_.get(), 16, (char *)&header[16]);
-      if (data_reader_->eof())
+      if (read_bytes(16, &header[16]) != 16)
 	return false;
     }
   } else {
-    if (first_header.legacy_mode == 0) {
-      Data_reader_blocking::get_bytes_s(data_reader_.get(), 32, (char *)&current_header);
-    } else {
-      Data_reader_blocking::get_bytes_s(data_reader_.get(), 16, (char *)&current_header);
-    }
-    if (data_reader_->eof())
+    const size_t header_size = first_header.header_size();
+    if (read_bytes(header_size, (char *)&current_header) != header_size)
       return false;
   }
 
@@ -169,21 +175,17 @@ VDIF_reader::read_new_block(Data_frame &data) {
     dorestart = true;
   }
   if (dorestart) {
-    Data_reader_blocking::get_bytes_s(data_reader_.get(), frame_size, NULL);
+    read_bytes(frame_size, NULL);
     if (++restarts > max_restarts)
       return false;
     goto restart;
   }
 
-  Data_reader_blocking::get_bytes_s( data_reader_.get(), frame_size, (char *)&buffer[0]);
-  if (data_reader_->eof())
+  if (read_bytes(frame_size, (char *)&buffer[0]) != (size_t)frame_size)
     return false;
 
   if (current_header.invalid > 0) {
-    struct Input_node_types::Invalid_block invalid;
-    invalid.invalid_begin = 0;
-    invalid.nr_invalid = frame_size;
-    data.invalid.push_back(invalid);
+    data.add_invalid(0, frame_size);
     if (thread_map.count(current_header.thread_id) > 0)
       data.channel = thread_map[current_header.thread_id];
     else
@@ -204,32 +206,115 @@ VDIF_reader::read_new_block(Data_frame &data) {
 
   for (int i = 1; i < vdif_frames_per_block; i++) {
     Header header;
-    if (first_header.legacy_mode == 0) {
-      Data_reader_blocking::get_bytes_s( data_reader_.get(), 32, (char *)&header);
-    } else {
-      Data_reader_blocking::get_bytes_s( data_reader_.get(), 16, (char *)&header);
-    }
-    if (data_reader_->eof())
+    const size_t header_size = first_header.header_size();
+    if ((read_bytes(header_size, (char *)&header) != header_size) ||
+        (read_bytes(frame_size, (char *)&buffer[i * frame_size]) != (size_t)frame_size))
       return false;
 
-    Data_reader_blocking::get_bytes_s( data_reader_.get(), frame_size, (char *)&buffer[i * frame_size]);
-    if (data_reader_->eof())
-      return false;
+    if (header.invalid > 0)
+      data.add_invalid(i * frame_size, frame_size);
+  }
 
-    if (header.invalid > 0) {
-      struct Input_node_types::Invalid_block invalid;
-      invalid.invalid_begin = i * frame_size;
-      invalid.nr_invalid = frame_size;
-      data.invalid.push_back(invalid);
-    }
+  data.start_time = get_current_time();
+  update_index(data.start_time, header_pos, current_header.thread_id);
+  return true;
+}
+
+bool
+VDIF_reader::read_frames(Data_frame &data) {
+  const size_t header_size = first_header.header_size();
+  const size_t frame_length = header_size + frame_size;
+  const size_t block_size = vdif_frames_per_block * frame_length;
+  if (!fill_read_buffer(block_size))
+    return false;
+
+  // Check all headers in the block at once, anything unusual is left to
+  // the checks in read_new_block
+  const char *block = &read_buffer[read_buffer_pos];
+  bool fill_pattern = false;
+  for (int i = 0; i < vdif_frames_per_block; i++) {
+    uint32_t words[4];
+    memcpy(words, block + i * frame_length, sizeof(words));
+    fill_pattern |= ((words[0] == 0x11223344) | (words[1] == 0x11223344) |
+                     (words[2] == 0x11223344) | (words[3] == 0x11223344));
+  }
+  Header header;
+  memcpy(&header, block, header_size);
+  if (fill_pattern || ((header.ref_epoch == 0) && (header.sec_from_epoch == 0)) ||
+      ((header.dataframe_in_second % vdif_frames_per_block) != 0))
+    return false;
+  std::map<int, int>::const_iterator thread = thread_map.find(header.thread_id);
+  if (thread == thread_map.end())
+    return false;
+
+  const uint64_t header_pos = data_reader_->data_counter() - bytes_buffered();
+  std::vector<value_type> &buffer = data.buffer->data;
+  if (buffer.size() == 0)
+    buffer.resize(size_data_block());
+  memcpy(&current_header, &header, header_size);
+  for (int i = 0; i < vdif_frames_per_block; i++) {
+    const char *frame = block + i * frame_length;
+    // The data of invalid frames is never used
+    if (((const Header *)frame)->invalid > 0)
+      data.add_invalid(i * frame_size, frame_size);
+    else
+      memcpy(&buffer[i * frame_size], frame + header_size, frame_size);
   }
+  data.channel = thread->second;
+  read_buffer_pos += block_size;
 
   data.start_time = get_current_time();
+  update_index(data.start_time, header_pos, current_header.thread_id);
   return true;
 }
 
+bool
+VDIF_reader::fill_read_buffer(size_t nbytes) {
+  if (read_buffer_end - read_buffer_pos >= nbytes)
+    return true;
+  if (read_buffer.size() < nbytes)
+    return false;
+
+  memmove(&read_buffer[0], &read_buffer[read_buffer_pos],
+          read_buffer_end - read_buffer_pos);
+  read_buffer_end -= read_buffer_pos;
+  read_buffer_pos = 0;
+  size_t nread = Data_reader_blocking::get_bytes_s(data_reader_.get(),
+                                                   read_buffer.size() - read_buffer_end,
+                                                   &read_buffer[read_buffer_end]);
+  read_buffer_end += nread;
+  return (read_buffer_end >= nbytes);
+}
+
+size_t
+VDIF_reader::read_bytes(size_t nbytes, char *out) {
+  size_t nread = 0;
+  while (nread < nbytes) {
+    if (read_buffer_pos == read_buffer_end) {
+      if (nbytes - nread >= read_buffer.size()) {
+        // Large reads and skips bypass the read buffer
+        return nread + Data_reader_blocking::get_bytes_s(data_reader_.get(), nbytes - nread,
+                                                         (out == NULL) ? NULL : out + nread);
+      }
+      if (!fill_read_buffer(1))
+        break;
+    }
+    size_t n = std::min(nbytes - nread, read_buffer_end - read_buffer_pos);
+    if (out != NULL)
+      memcpy(out + nread, &read_buffer[read_buffer_pos], n);
+    read_buffer_pos += n;
+    nread += n;
+  }
+  return nread;
+}
+
+size_t
+VDIF_reader::skip_bytes(size_t nbytes) {
+  return read_bytes(nbytes, NULL);
+}
+
 bool VDIF_reader::eof() {
-  return data_reader_->eof();
+  return (read_buffer_pos == read_buffer_end) && data_reader_->eof();
 }
 
 int32_t VDIF_reader::Header::jday_epoch() const {
@@ -265,4 +350,11 @@ void VDIF_reader::set_parameters(const Input_node_parameters &param) {
     bits_per_complete_sample = param.n_tracks;
   }
   SFXC_ASSERT(time_between_headers_.get_time_usec() > 0);
+
+  // Read a whole number of frames at once, the header size is not known
+  // until the first header has been read
+  const size_t frame_length = frame_size + 32;
+  const size_t frames_per_read = std::max(VDIF_READ_BUFFER_SIZE / frame_length,
+                                          (size_t)vdif_frames_per_block);
+  read_buffer.resize(std::max(frames_per_read * frame_length, read_buffer_end));
 }
@@ -0,0 +1,118 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ * $Id$
+ *
+ */
+
+#include "worker_pool.h"
+#include "utils.h"
+
+Worker_pool::Worker_pool()
+  : job(NULL), generation(0), n_busy(0), stopping(false) {
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&start_cond, NULL);
+  pthread_cond_init(&done_cond, NULL);
+}
+
+Worker_pool::~Worker_pool() {
+  stop_threads();
+  pthread_cond_destroy(&done_cond);
+  pthread_cond_destroy(&start_cond);
+  pthread_mutex_destroy(&lock);
+}
+
+void
+Worker_pool::resize(int n_threads) {
+  SFXC_ASSERT(n_threads >= 1);
+  if (n_threads == size())
+    return;
+
+  stop_threads();
+
+  // The vector of workers should not be reallocated once the threads run
+  workers.resize(n_threads - 1);
+  threads.resize(n_threads - 1);
+  for (size_t i = 0; i < threads.size(); i++) {
+    workers[i].pool = this;
+    workers[i].part = i + 1;
+    workers[i].generation = generation;
+    if (pthread_create(&threads[i], NULL, process, &workers[i]) != 0)
+      sfxc_abort("Could not create worker thread");
+  }
+}
+
+void
+Worker_pool::stop_threads() {
+  if (threads.empty())
+    return;
+
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_broadcast(&start_cond);
+  pthread_mutex_unlock(&lock);
+
+  for (size_t i = 0; i < threads.size(); i++)
+    pthread_join(threads[i], NULL);
+  threads.clear();
+  workers.clear();
+  stopping = false;
+}
+
+void
+Worker_pool::run(Job &job_) {
+  if (threads.empty()) {
+    job_.run(0, 1);
+    return;
+  }
+
+  const int n_parts = size();
+  pthread_mutex_lock(&lock);
+  job = &job_;
+  n_busy = threads.size();
+  generation++;
+  pthread_cond_broadcast(&start_cond);
+  pthread_mutex_unlock(&lock);
+
+  job_.run(0, n_parts);
+
+  pthread_mutex_lock(&lock);
+  while (n_busy > 0)
+    pthread_cond_wait(&done_cond, &lock);
+  job = NULL;
+  pthread_mutex_unlock(&lock);
+}
+
+void *
+Worker_pool::process(void *worker_) {
+  Worker *worker = static_cast<Worker *>(worker_);
+  Worker_pool *pool = worker->pool;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while ((pool->generation == worker->generation) && !pool->stopping)
+      pthread_cond_wait(&pool->start_cond, &pool->lock);
+    if (pool->stopping)
+      break;
+    worker->generation = pool->generation;
+    Job *job = pool->job;
+    const int n_parts = pool->size();
+    pthread_mutex_unlock(&pool->lock);
+
+    job->run(worker->part, n_parts);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->n_busy == 0)
+      pthread_cond_signal(&pool->done_cond);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+void
+Worker_pool::partition(size_t n, int part, int n_parts,
+                       size_t &begin, size_t &end, size_t align) {
+  const size_t n_blocks = (n + align - 1) / align;
+  begin = std::min(n, (n_blocks * part / n_parts) * align);
+  end = std::min(n, (n_blocks * (part + 1) / n_parts) * align);
+}
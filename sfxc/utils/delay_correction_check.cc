@@ -0,0 +1,189 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ * Compares the single fft delay correction with the two fft delay
+ * correction on synthetic noise for one station. With a constant delay of
+ * an integer number of samples both give the same spectra up to rounding.
+ * With a fractional delay and a low delay rate the single fft correction
+ * is an approximation, there the two sets of spectra have to be coherent.
+ *
+ * Usage: sfxc-delay-correction-check
+ */
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cmath>
+
+#undef USE_MPI
+#include "delay_correction.h"
+#include "delay_table_akima.h"
+#include "utils.h"
+
+typedef Correlator_node_types::Channel_memory_pool Input_memory_pool;
+typedef std::vector< std::complex<double> > Spectra;
+
+const int scan_mjd = 57000;
+const double scan_start = 43200; // seconds since midnight
+const int scan_length = 20;
+const uint64_t sample_rate = 32000000;
+const uint64_t bandwidth = 16000000;
+const int64_t channel_freq = 1600000000;
+const int fft_size = 256;
+const int nfft_per_block = 32;
+const int nblocks = 64;
+
+// Writes a delay table with one scan, the delay is delay0 + rate * t
+void write_delay_table(const char *filename, double delay0, double rate) {
+  std::ofstream out(filename, std::ios::binary);
+  int32_t header[2] = {1, 0}; // version, n_padding
+  int32_t header_size = sizeof(header);
+  out.write((const char *)&header_size, sizeof(header_size));
+  out.write((const char *)header, sizeof(header));
+  char scan[81], source[81];
+  memset(scan, 0, sizeof(scan));
+  strcpy(scan, "check");
+  memset(source, ' ', sizeof(source));
+  memcpy(source, "CHECK", 5);
+  source[80] = 0;
+  out.write(scan, sizeof(scan));
+  out.write(source, sizeof(source));
+  out.write((const char *)&scan_mjd, sizeof(scan_mjd));
+  for (int i = 0; i <= scan_length; i++) {
+    // time, u, v, w, delay, phase, amplitude
+    double line[7] = {scan_start + i, 0, 0, 0, delay0 + rate * i, 0, 1};
+    out.write((const char *)line, sizeof(line));
+  }
+  double end_of_scan[7] = {0, 0, 0, 0, 0, 0, 0};
+  out.write((const char *)end_of_scan, sizeof(end_of_scan));
+}
+
+// Runs the delay correction over nblocks blocks of noise and returns all
+// spectra in the output
+void delay_correct(const Correlation_parameters &parameters,
+                   Delay_table_akima &delays, bool single_fft,
+                   Spectra &spectra) {
+  Input_memory_pool input_pool(nblocks);
+  Delay_correction::Input_buffer_ptr input(new Delay_correction::Input_buffer());
+  Delay_correction delay_correction(0);
+  delay_correction.connect_to(input);
+  delay_correction.set_parameters(parameters, delays);
+  delay_correction.set_single_fft(single_fft);
+
+  park_miller_set_seed(42);
+  spectra.clear();
+  for (int block = 0; block < nblocks; block++) {
+    Input_memory_pool::Element element = input_pool.allocate();
+    element->nfft = nfft_per_block;
+    element->data.resize(nfft_per_block * fft_size);
+    for (int i = 0; i < nfft_per_block * fft_size; i++)
+      element->data[i] = (double)park_miller_random() / (1UL << 30) - 1;
+    input->push(element);
+
+    while (delay_correction.has_work()) {
+      delay_correction.do_task();
+      Delay_correction::Output_buffer_element output =
+        delay_correction.get_output_buffer()->front_and_pop();
+      const size_t n = output->stride;
+      for (size_t i = 0; i + n <= output->data.size(); i += n)
+        spectra.insert(spectra.end(), &output->data[i],
+                       &output->data[i] + parameters.fft_size_correlation + 1);
+    }
+  }
+}
+
+// Compares the single fft spectra with the two fft spectra, returns the
+// coherence and sets the rms difference relative to the rms amplitude
+double compare(const Spectra &single, const Spectra &two, double &rms_difference) {
+  SFXC_ASSERT(single.size() == two.size());
+  std::complex<double> cross = 0;
+  double power_single = 0, power_two = 0, power_difference = 0;
+  for (size_t i = 0; i < single.size(); i++) {
+    cross += single[i] * std::conj(two[i]);
+    power_single += std::norm(single[i]);
+    power_two += std::norm(two[i]);
+    power_difference += std::norm(single[i] - two[i]);
+  }
+  rms_difference = std::sqrt(power_difference / power_two);
+  return std::abs(cross) / std::sqrt(power_single * power_two);
+}
+
+int main(int argc, char** argv) {
+  Time start(scan_mjd, scan_start + 5);
+
+  Correlation_parameters parameters;
+  parameters.experiment_start = start;
+  parameters.slice_start = start;
+  parameters.stream_start = start;
+  parameters.integration_start = start;
+  parameters.slice_size = (int64_t)nblocks * nfft_per_block * fft_size;
+  parameters.slice_time = Time((double)parameters.slice_size / (sample_rate / 1000000));
+  parameters.integration_time = parameters.slice_time;
+  parameters.number_channels = fft_size;
+  parameters.fft_size_delaycor = fft_size;
+  parameters.fft_size_correlation = fft_size;
+  parameters.sample_rate = sample_rate;
+  parameters.channel_freq = channel_freq;
+  parameters.bandwidth = bandwidth;
+  parameters.sideband = 'U';
+  parameters.window = SFXC_WINDOW_COS;
+
+  Correlation_parameters::Station_parameters station;
+  station.station_number = 0;
+  station.station_stream = 0;
+  station.sample_rate = sample_rate;
+  station.channel_freq = channel_freq;
+  station.bandwidth = bandwidth;
+  station.sideband = 'U';
+  station.polarisation = 'R';
+  station.bits_per_sample = 2;
+  station.LO_offset = 0;
+  station.extra_delay = 0;
+  station.tsys_freq = 0;
+  parameters.station_streams.push_back(station);
+
+  struct {
+    const char *name;
+    double delay0, rate, min_coherence, max_rms_difference;
+  } configurations[] = {
+    // 40 samples
+    {"integer delay", 40. / sample_rate, 0, 0.99999, 1e-4},
+    // 40.3 samples, the fringe phase drifts 0.003 turns per correlation fft
+    {"fractional delay", 40.3 / sample_rate, 1e-7, 0.99, 0.15}
+  };
+
+  char filename[] = "/tmp/sfxc-delay-correction-check-XXXXXX";
+  int fd = mkstemp(filename);
+  if (fd < 0) {
+    std::cout << "Could not create a temporary delay table\n";
+    return 1;
+  }
+  close(fd);
+
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(configurations) / sizeof(configurations[0]); i++) {
+    write_delay_table(filename, configurations[i].delay0, configurations[i].rate);
+    Delay_table delay_table;
+    delay_table.open(filename);
+    delay_table.set_clock_offset(0, Time(scan_mjd, scan_start), 0, Time(scan_mjd, scan_start));
+    Delay_table_akima delays =
+      delay_table.create_akima_spline(parameters.slice_start, parameters.slice_time);
+
+    Spectra single, two;
+    delay_correct(parameters, delays, true, single);
+    delay_correct(parameters, delays, false, two);
+    double rms_difference;
+    double coherence = compare(single, two, rms_difference);
+    bool pass = (coherence >= configurations[i].min_coherence) &&
+                (rms_difference <= configurations[i].max_rms_difference);
+    std::cout << configurations[i].name << ": " << two.size() / (fft_size + 1)
+              << " spectra, coherence " << coherence
+              << ", rms difference " << rms_difference
+              << (pass ? "" : "  FAILED") << "\n";
+    ok = ok && pass;
+  }
+  unlink(filename);
+  return ok ? 0 : 1;
+}
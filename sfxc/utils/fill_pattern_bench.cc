@@ -0,0 +1,131 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ * Measures the speed of the fill pattern scanner of the format readers on
+ * synthetic frames with an increasing fraction of fill pattern, and checks
+ * the result against the scalar scanner.
+ *
+ * Usage: sfxc-fill-pattern-bench [frame size in bytes] [total MB per test]
+ */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "fill_pattern_scanner.h"
+#include "utils.h"
+
+typedef std::vector<Input_node_types::Invalid_block> Invalid_list;
+
+double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Fill runs of 1 to 4096 words at random positions until the given fraction
+// of the frame is fill pattern
+void make_frame(std::vector<unsigned char> &frame, double fill_fraction) {
+  const size_t nwords = frame.size() / 4;
+  for (size_t i = 0; i < nwords; i++) {
+    uint32_t word = park_miller_random();
+    if (word == MARK5_FILLPATTERN)
+      word++;
+    memcpy(&frame[4 * i], &word, 4);
+  }
+  const uint32_t pattern = MARK5_FILLPATTERN;
+  size_t nfill = 0;
+  while (nfill < fill_fraction * nwords) {
+    size_t start = park_miller_random() % nwords;
+    size_t length = std::min(nwords - start, (size_t)(park_miller_random() % 4096 + 1));
+    for (size_t i = start; i < start + length; i++) {
+      uint32_t word;
+      memcpy(&word, &frame[4 * i], 4);
+      if (word != pattern) {
+        memcpy(&frame[4 * i], &pattern, 4);
+        nfill++;
+      }
+    }
+  }
+}
+
+void flag_scalar(const std::vector<unsigned char> &frame, Invalid_list &invalid) {
+  const size_t nwords = frame.size() / 4;
+  size_t start = 0;
+  while ((start = scan_fill_pattern_scalar(&frame[0], start, nwords, true)) < nwords) {
+    size_t end = scan_fill_pattern_scalar(&frame[0], start, nwords, false);
+    Input_node_types::add_invalid(invalid, 4 * start, 4 * (end - start));
+    start = end;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  size_t frame_size = (argc > 1) ? atoi(argv[1]) : 80000;
+  size_t total = ((argc > 2) ? atoi(argv[2]) : 1024) * (size_t)1000000;
+  frame_size -= frame_size % 4;
+  if (frame_size == 0) {
+    std::cerr << "Usage: " << argv[0] << " [frame size in bytes] [total MB per test]\n";
+    return 1;
+  }
+  const int nframes = 16;
+  const size_t repeat = std::max((size_t)1, total / (nframes * frame_size));
+
+  std::cout << "Scanner: " << fill_pattern_scanner_name() << ", frames of "
+            << frame_size << " bytes\n";
+  std::cout << "  fill %    blocks      scalar MB/s     " << fill_pattern_scanner_name()
+            << " MB/s\n";
+  const double fractions[] = {0, 0.001, 0.01, 0.1, 0.5, 0.9, 1};
+  bool ok = true;
+  for (size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); f++) {
+    std::vector<std::vector<unsigned char> > frames(nframes, std::vector<unsigned char>(frame_size));
+    for (int i = 0; i < nframes; i++)
+      make_frame(frames[i], fractions[f]);
+
+    Invalid_list invalid, reference;
+    size_t nblocks = 0;
+    double start = now();
+    for (size_t r = 0; r < repeat; r++) {
+      for (int i = 0; i < nframes; i++) {
+        reference.clear();
+        flag_scalar(frames[i], reference);
+      }
+    }
+    double scalar_time = now() - start;
+
+    start = now();
+    for (size_t r = 0; r < repeat; r++) {
+      for (int i = 0; i < nframes; i++) {
+        invalid.clear();
+        flag_fill_pattern(&frames[i][0], frame_size, 0, invalid);
+        nblocks += invalid.size();
+      }
+    }
+    double simd_time = now() - start;
+
+    for (int i = 0; i < nframes; i++) {
+      invalid.clear();
+      reference.clear();
+      flag_fill_pattern(&frames[i][0], frame_size, 0, invalid);
+      flag_scalar(frames[i], reference);
+      bool same = (invalid.size() == reference.size());
+      for (size_t j = 0; same && (j < invalid.size()); j++)
+        same = (invalid[j].invalid_begin == reference[j].invalid_begin) &&
+               (invalid[j].nr_invalid == reference[j].nr_invalid);
+      ok = ok && same;
+    }
+
+    const double mbytes = repeat * nframes * frame_size / 1e6;
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(8) << 100 * fractions[f]
+              << std::setw(10) << nblocks / (repeat * nframes)
+              << std::setw(17) << mbytes / scalar_time
+              << std::setw(17) << mbytes / simd_time << "\n";
+  }
+  if (!ok) {
+    std::cout << "ERROR: the invalid blocks differ from the scalar scanner\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+/* Copyright (c) 2007 Joint Institute for VLBI in Europe (Netherlands)
+ * All rights reserved.
+ *
+ * Creates fftw wisdom for the ffts that a correlation with the given
+ * control file will use. The correlator nodes load the wisdom at startup
+ * when fftw_wisdom_dir in the control file points to the wisdom directory.
+ */
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+#undef USE_MPI
+#include "exception_common.h"
+#include "control_parameters.h"
+#include "log_writer_cout.h"
+#include "sfxc_fft_float.h"
+#include "utils.h"
+
+#ifdef USE_IPP
+int main(int argc, char** argv) {
+  std::cout << "The fft plans can only be tuned when sfxc uses fftw\n";
+  return 1;
+}
+#else
+// Buffers that are large enough for all transforms of one size
+struct Tune_buffers {
+  Tune_buffers(size_t size) {
+    real = (float *)fftwf_malloc(size * sizeof(float));
+    complex = (std::complex<float> *)fftwf_malloc(size * sizeof(std::complex<float>));
+    if ((real == NULL) || (complex == NULL))
+      sfxc_abort("Unable to allocate buffer for fft\n");
+    memset(real, 0, size * sizeof(float));
+    memset(complex, 0, size * sizeof(std::complex<float>));
+  }
+  ~Tune_buffers() {
+    fftwf_free(real);
+    fftwf_free(complex);
+  }
+  float *real;
+  std::complex<float> *complex;
+};
+
+// Plan (and execute once) the transforms of Delay_correction::do_task and
+// Correlation_core::integration_write. The station sample rates are assumed
+// to be equal to the correlation sample rate.
+void tune(int fft_size_delaycor, int fft_size_correlation, int number_channels) {
+  const int n = fft_size_delaycor;
+  const int m = 2 * fft_size_correlation;
+  const int nbuffer = std::max(CORRELATOR_BUFFER_SIZE / n,
+                               std::max(fft_size_correlation / n, 1));
+  const int nfft_cor = (nbuffer * n) / (m / 2);
+  const int output_stride = fft_size_correlation + 4;
+
+  std::cout << "Delay correction: " << nbuffer << " x " << n << " points\n";
+  {
+    Tune_buffers buffers(nbuffer * n);
+    sfxc_fft_fftw_float fft_t2f, fft_f2t;
+    fft_t2f.resize(n);
+    fft_f2t.resize(n);
+    fft_t2f.rfft_many(buffers.real, n, buffers.complex, n, nbuffer);
+    fft_f2t.ifft_many(buffers.complex, n, buffers.complex, n, nbuffer);
+  }
+
+  std::cout << "Correlation: " << nfft_cor << " x " << m << " points\n";
+  {
+    Tune_buffers buffers((nfft_cor + 1) * std::max(m, output_stride));
+    sfxc_fft_fftw_float fft_t2f_cor;
+    fft_t2f_cor.resize(m);
+    // The number of ffts per block varies by one
+    for (int howmany = std::max(nfft_cor - 1, 1); howmany <= nfft_cor + 1; howmany++)
+      fft_t2f_cor.rfft_many(buffers.real, m, buffers.complex, output_stride, howmany);
+  }
+
+  if (fft_size_correlation != number_channels) {
+    std::cout << "Output: " << 2 * fft_size_correlation << " -> "
+              << 2 * number_channels << " points\n";
+    const int complex_stride = fft_size_correlation + 1;
+    const int real_stride = 2 * fft_size_correlation;
+    Tune_buffers buffers(OUTPUT_FFT_BATCH * real_stride);
+    sfxc_fft_fftw_float fft_f2t, fft_t2f;
+    fft_f2t.resize(2 * fft_size_correlation);
+    fft_t2f.resize(2 * number_channels);
+    for (int howmany = 1; howmany <= OUTPUT_FFT_BATCH; howmany++) {
+      fft_f2t.irfft_many(buffers.complex, complex_stride,
+                         buffers.real, real_stride, howmany);
+      fft_t2f.rfft_many(buffers.real, real_stride,
+                        buffers.complex, complex_stride, howmany);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  if ((argc < 3) || (argc > 4)) {
+    std::cout << "Usage: " << argv[0] << " <ctrl-file> <vex-file> [<wisdom-dir>]\n"
+              << "  The default wisdom directory is fftw_wisdom_dir in the ctrl-file\n";
+    exit(1);
+  }
+
+  Control_parameters control_parameters;
+  Log_writer_cout log_writer(0);
+  try {
+    if (!control_parameters.initialise(argv[1], argv[2], log_writer)) {
+      std::cout << "Invalid control file\n";
+      exit(1);
+    }
+  } catch (Exception &ex) {
+    std::cout << ex << std::endl;
+    exit(1);
+  }
+
+  std::string wisdom_dir;
+  if (argc == 4)
+    wisdom_dir = argv[3];
+  else
+    wisdom_dir = control_parameters.fftw_wisdom_dir();
+  if (wisdom_dir.empty()) {
+    std::cout << "No wisdom directory given and fftw_wisdom_dir is not set\n";
+    exit(1);
+  }
+  std::string wisdom_file = sfxc_fft_fftw_float::wisdom_filename(wisdom_dir);
+
+  // Add to the existing wisdom
+  if (sfxc_fft_fftw_float::import_wisdom(wisdom_file))
+    std::cout << "Loaded wisdom from " << wisdom_file << "\n";
+
+  sfxc_fft_fftw_float::set_planner_flags(FFTW_PATIENT);
+  tune(control_parameters.fft_size_delaycor(),
+       control_parameters.fft_size_correlation(),
+       control_parameters.number_channels());
+
+  if (!sfxc_fft_fftw_float::export_wisdom(wisdom_file)) {
+    std::cout << "Could not write wisdom to " << wisdom_file << "\n";
+    exit(1);
+  }
+  std::cout << "Wisdom written to " << wisdom_file << "\n";
+  return 0;
+}
+#endif // USE_IPP